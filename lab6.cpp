@@ -8,6 +8,28 @@
 #include <map>
 #include <cmath>
 #include <list>
+#include <climits>
+#include <stdexcept>
+#include <limits>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+const int PRIORITY_LEVELS = 140;
+const int DEFAULT_PRIORITY = 120;
+
+struct Segment
+{
+    int start;
+    int end; // exclusive
+};
 
 struct Process
 {
@@ -21,13 +43,35 @@ struct Process
     float ratio;
     int i;
     int quantum;
-    std::vector<char> timeline;
+    int deadline; // relative to arrivalTime, -1 when the process has none
+    int period;   // minimum inter-arrival time, -1 when the process has none
+    int priority; // static priority level, 0 (highest) to 139
+    std::vector<int> bursts;    // cpu, I/O, cpu, ... durations; serviceTime is the cpu total
+    int burst;                  // index of the current cpu burst
+    int burstLeft;              // cpu still owed to the current burst
+    int readyTime;              // when the process last became ready
+    int wakeTime;               // end of the current I/O burst (arrival before the first one)
+    std::vector<int> responses; // ready-to-dispatch delay of each cpu burst
+    std::vector<Segment> runs;   // ticks on the cpu, in time order
+    std::vector<Segment> blocks; // ticks blocked on I/O, in time order
 };
 
-void printCenteredInt(int value, int width)
+int absoluteDeadline(const Process &p)
+{
+    return p.deadline < 0 ? INT_MAX : p.arrivalTime + p.deadline;
+}
+
+// Rate-monotonic rank: an explicit period wins, otherwise the deadline stands in for it.
+int rmPeriod(const Process &p)
+{
+    if (p.period > 0)
+        return p.period;
+    return p.deadline > 0 ? p.deadline : INT_MAX;
+}
+
+void printCenteredText(std::string str, int width)
 {
-    std::string str = std::to_string(value);
-    int padding = width - str.length();
+    int padding = std::max(width - int(str.length()), 0);
     int leftPadding = padding / 2;
     int rightPadding = padding - leftPadding;
 
@@ -37,12 +81,17 @@ void printCenteredInt(int value, int width)
               << std::string(rightPadding, ' ');
 }
 
+void printCenteredInt(int value, int width)
+{
+    printCenteredText(std::to_string(value), width);
+}
+
 void printCenteredFloat(float value, int width)
 {
     std::ostringstream oss;
     oss << std::fixed << std::setprecision(2) << value;
     std::string str = oss.str();
-    int padding = width - str.length();
+    int padding = std::max(width - int(str.length()), 0);
     int rightPadding = padding / 2;
     int leftPadding = padding - rightPadding;
 
@@ -52,6 +101,47 @@ void printCenteredFloat(float value, int width)
               << std::string(rightPadding, ' ');
 }
 
+// Glyph for the ticks [start, end) of one process: "*" if it ran at any point,
+// otherwise "~" if it was blocked, "." if it was waiting and " " if it was not
+// in the system. ri and bi are cursors into p.runs and p.blocks; cells must be
+// asked for left to right so each segment is visited once.
+char glyphAt(const Process &p, int &ri, int &bi, int start, int end)
+{
+    while (ri < p.runs.size() && p.runs[ri].end <= start)
+        ri++;
+    while (bi < p.blocks.size() && p.blocks[bi].end <= start)
+        bi++;
+
+    if (ri < p.runs.size() && p.runs[ri].start < end)
+        return '*';
+    if (bi < p.blocks.size() && p.blocks[bi].start < end)
+        return '~';
+    if (p.arrivalTime < end && (p.finishTime == -1 || start < p.finishTime))
+        return '.';
+    return ' ';
+}
+
+// One chart row covering columns [first, last) of a window starting at from,
+// each column standing for zoom ticks.
+void traceRow(const Process &p, int from, int to, int zoom, int first, int last)
+{
+    int start = from + first * zoom;
+    auto run = std::lower_bound(p.runs.begin(), p.runs.end(), start, [](const Segment &s, int t)
+                                { return s.end <= t; });
+    auto block = std::lower_bound(p.blocks.begin(), p.blocks.end(), start, [](const Segment &s, int t)
+                                  { return s.end <= t; });
+    int ri = run - p.runs.begin();
+    int bi = block - p.blocks.begin();
+
+    std::cout << p.name << "     ";
+    for (int c = first; c < last; c++)
+    {
+        int cellStart = from + c * zoom;
+        std::cout << "|" << glyphAt(p, ri, bi, cellStart, std::min(cellStart + zoom, to));
+    }
+    std::cout << "| \n";
+}
+
 void tracePrint(std::vector<Process> &processes, int no_of_processes, std::string name, int simulationTime)
 {
     std::cout << name;
@@ -64,17 +154,228 @@ void tracePrint(std::vector<Process> &processes, int no_of_processes, std::strin
 
     for (const auto &process : processes)
     {
-        std::cout << process.name << "     ";
-        for (int t = 0; t < simulationTime; t++)
-        {
-            std::cout << "|" << process.timeline[t];
-        }
-        std::cout << "| \n";
+        traceRow(process, 0, simulationTime, 1, 0, simulationTime);
     }
     std::cout << "------------------------------------------------\n";
     std::cout << "\n";
 }
 
+// Ticks [from, to) in pages of pageColumns columns, zoom ticks per column.
+void windowPrint(std::vector<Process> &processes, std::string name, int from, int to, int zoom)
+{
+    const int pageColumns = 50;
+    int columns = (to - from + zoom - 1) / zoom;
+
+    for (int first = 0; first < columns; first += pageColumns)
+    {
+        int last = std::min(first + pageColumns, columns);
+        std::string dashes(6 + 2 * (last - first) + 1, '-');
+
+        std::cout << name << "  t=" << from + first * zoom << ".." << std::min(from + last * zoom, to)
+                  << " (" << zoom << " per column)\n";
+        std::cout << std::string(6, ' ');
+        for (int c = first; c < last; c += 5)
+        {
+            std::string label = std::to_string(from + c * zoom);
+            std::cout << label << std::string(std::max(10 - int(label.size()), 1), ' ');
+        }
+        std::cout << "\n"
+                  << dashes << "\n";
+
+        for (const auto &process : processes)
+        {
+            traceRow(process, from, to, zoom, first, last);
+        }
+        std::cout << dashes << "\n\n";
+    }
+}
+
+// Text for an SVG/HTML text node: process names are any character.
+std::string xmlEscape(const std::string &text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '<')
+            escaped += "&lt;";
+        else if (c == '>')
+            escaped += "&gt;";
+        else if (c == '&')
+            escaped += "&amp;";
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+void svgRect(float x, float y, float width, float height, const char *fill)
+{
+    std::cout << "<rect x=\"" << x << "\" y=\"" << y << "\" width=\"" << width
+              << "\" height=\"" << height << "\" fill=\"" << fill << "\"/>\n";
+}
+
+// Gantt chart of ticks [from, to), one 16px cell per zoom ticks. Rectangles
+// are written straight from the run and I/O segments; waiting is whatever
+// is left of the process's lifetime between them.
+void svgPrint(std::vector<Process> &processes, std::string name, int from, int to, int zoom)
+{
+    const float cell = 16;
+    const float left = 40;
+    float scale = cell / zoom;
+    float width = left + (to - from) * scale + cell;
+    float height = 24 + processes.size() * 20 + 20;
+
+    std::cout << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height
+              << "\" font-family=\"monospace\" font-size=\"12\">\n";
+    std::cout << "<text x=\"4\" y=\"14\">" << xmlEscape(name) << "</text>\n";
+
+    float y = 24;
+    for (const auto &p : processes)
+    {
+        std::cout << "<text x=\"4\" y=\"" << y + 13 << "\">" << xmlEscape(std::string(1, p.name)) << "</text>\n";
+
+        int end = std::min(p.finishTime == -1 ? to : p.finishTime, to);
+        int t = std::max(p.arrivalTime, from);
+        int ri = 0;
+        int bi = 0;
+        while (ri < p.runs.size() && p.runs[ri].end <= from)
+            ri++;
+        while (bi < p.blocks.size() && p.blocks[bi].end <= from)
+            bi++;
+
+        // merge the two sorted segment lists, filling the gaps as waiting
+        while (t < end)
+        {
+            bool run = ri < p.runs.size() && (bi >= p.blocks.size() || p.runs[ri].start < p.blocks[bi].start);
+            const Segment *next = run ? &p.runs[ri] : bi < p.blocks.size() ? &p.blocks[bi] : nullptr;
+            int gapEnd = next ? std::min(std::max(next->start, t), end) : end;
+            if (gapEnd > t)
+            {
+                svgRect(left + (t - from) * scale, y + 4, (gapEnd - t) * scale, 8, "#d8d8d8");
+            }
+            if (!next || next->start >= end)
+            {
+                break;
+            }
+
+            int start = std::max(next->start, from);
+            int stop = std::min(next->end, to);
+            svgRect(left + (start - from) * scale, y, (stop - start) * scale, 16, run ? "#3b7dd8" : "#e0a030");
+            t = stop;
+            (run ? ri : bi)++;
+        }
+        y += 20;
+    }
+
+    for (int tick = from; tick <= to; tick += 10 * zoom)
+    {
+        float x = left + (tick - from) * scale;
+        std::cout << "<line x1=\"" << x << "\" y1=\"20\" x2=\"" << x << "\" y2=\"" << y
+                  << "\" stroke=\"#999\" stroke-width=\"0.5\"/>\n";
+        std::cout << "<text x=\"" << x << "\" y=\"" << y + 14 << "\">" << tick << "</text>\n";
+    }
+    std::cout << "</svg>\n";
+}
+
+// Nearest-rank percentile of an ascending list.
+int percentile(const std::vector<int> &sorted, float q)
+{
+    int rank = int(std::ceil(q * sorted.size()));
+    return sorted[std::max(rank, 1) - 1];
+}
+
+// Extra stat rows, only printed when the workload has I/O bursts.
+void burstPrint(std::vector<Process> &processes)
+{
+    bool io = false;
+    for (const auto &process : processes)
+    {
+        io = io || process.bursts.size() > 1;
+    }
+    if (!io)
+    {
+        return;
+    }
+
+    std::cout << "Response" << "   ";
+    float sum = 0;
+    int count = 0;
+    int first = INT_MAX;
+    int last = 0;
+    int busy = 0;
+    for (const auto &process : processes)
+    {
+        int total = 0;
+        for (int response : process.responses)
+        {
+            total += response;
+        }
+        sum += total;
+        count += process.responses.size();
+        printCenteredFloat(process.responses.empty() ? 0 : float(total) / process.responses.size(), 5);
+
+        first = std::min(first, process.arrivalTime);
+        last = std::max(last, process.finishTime);
+        busy += process.serviceTime;
+    }
+    printCenteredFloat(count == 0 ? 0 : sum / count, 5);
+    std::cout << "|" << "\n";
+
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2) << (last > first ? 100.0f * busy / (last - first) : 0);
+    std::cout << "CPU utilization " << oss.str() << "%\n";
+}
+
+// Extra stat rows, only printed when at least one process carries a deadline.
+void deadlinePrint(std::vector<Process> &processes)
+{
+    std::vector<int> lateness;
+    for (const auto &process : processes)
+    {
+        if (process.deadline >= 0)
+        {
+            lateness.push_back(process.finishTime - absoluteDeadline(process));
+        }
+    }
+    if (lateness.empty())
+    {
+        return;
+    }
+
+    std::cout << "Deadline" << "   ";
+    for (const auto &process : processes)
+    {
+        if (process.deadline >= 0)
+            printCenteredInt(absoluteDeadline(process), 5);
+        else
+            printCenteredText("-", 5);
+    }
+    std::cout << "|" << "\n"
+              << "Lateness" << "   ";
+    float sum = 0;
+    int misses = 0;
+    for (const auto &process : processes)
+    {
+        if (process.deadline >= 0)
+            printCenteredInt(process.finishTime - absoluteDeadline(process), 5);
+        else
+            printCenteredText("-", 5);
+    }
+    for (int late : lateness)
+    {
+        sum += late;
+        misses += late > 0;
+    }
+    printCenteredFloat(sum / lateness.size(), 5);
+    std::cout << "|" << "\n";
+
+    std::sort(lateness.begin(), lateness.end());
+    std::cout << "Misses " << misses << "/" << lateness.size()
+              << "  Lateness p50 " << percentile(lateness, 0.50f)
+              << " p90 " << percentile(lateness, 0.90f)
+              << " p99 " << percentile(lateness, 0.99f) << "\n";
+}
+
 void statPrint(std::vector<Process> &processes, int no_of_processes, std::string name)
 {
     std::cout << name << "\n";
@@ -121,322 +422,630 @@ void statPrint(std::vector<Process> &processes, int no_of_processes, std::string
     }
     result = sum / no_of_processes;
     printCenteredFloat(result, 5);
-    std::cout << "|\n\n";
+    std::cout << "|\n";
+    burstPrint(processes);
+    deadlinePrint(processes);
+    std::cout << "\n";
 }
 
-void FCFS(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes)
+// Prints the outcome of one policy run. mode is the first input line:
+//   trace                          the full chart
+//   trace <from> <to> [zoom]       ticks [from, to) in pages, zoom ticks per column
+//   svg|html [<from> <to> [zoom]]  Gantt chart as SVG; main wraps html in a page,
+//                                  svg is a document of its own so takes one policy
+//   stats                          the statistics table
+void report(std::vector<Process> &processes, std::string mode, std::string name, int simulationTime)
 {
-    int currentTime = 0;
-    int maxTime = simulationTime;
-    std::vector<std::string> timeline(maxTime, " ");
-    if (mode == "trace")
+    std::istringstream in(mode);
+    std::string kind;
+    std::vector<int> args;
+    int value;
+    in >> kind;
+    while (in >> value)
     {
-        std::cout << "FCFS  ";
-        for (int i = 0; i <= maxTime; ++i)
-        {
-            std::cout << i % 10 << " ";
-        }
-        std::cout << std::endl;
-        std::cout << "------------------------------------------------" << std::endl;
+        args.push_back(value);
     }
+    int from = args.size() >= 2 ? std::max(args[0], 0) : 0;
+    int to = args.size() >= 2 ? std::max(args[1], from) : simulationTime;
+    int zoom = args.size() >= 3 ? std::max(args[2], 1) : 1;
 
-    for (auto &p : processes)
+    if (kind == "stats")
     {
+        statPrint(processes, processes.size(), name);
+    }
+    else if (kind == "trace" && args.size() < 2)
+    {
+        tracePrint(processes, processes.size(), name + std::string(std::max(6 - int(name.size()), 1), ' '), simulationTime);
+    }
+    else if (kind == "trace")
+    {
+        windowPrint(processes, name, from, to, zoom);
+    }
+    else if (kind == "svg" || kind == "html")
+    {
+        svgPrint(processes, name, from, to, zoom);
+    }
+}
 
-        if (currentTime < p.arrivalTime)
-        {
-            currentTime = p.arrivalTime; // If the current time is less than the arrival time, jump to arrival time
-        }
-
-        p.startTime = currentTime;
-        p.finishTime = currentTime + p.serviceTime;
-        currentTime = p.finishTime;
+// Index of a process in its workload. Ready queues, heaps and timer slots
+// hold these rather than Process pointers.
+typedef unsigned int ProcessId;
+const ProcessId NO_PROCESS = ~0u;
 
-        if (p.arrivalTime < p.startTime)
-        { // put "." in the intervals where the cpu is not free and this process has already arrived
-            for (int i = p.arrivalTime; i <= p.startTime; i++)
-            {
-                timeline[i] = ".";
-            }
-        }
+// Backing store for a set of FIFOs. A process sits in at most one of them at
+// a time, so one next link per process is the whole pool: it is sized once
+// from no_of_processes and pushing or popping never allocates.
+struct QueuePool
+{
+    std::vector<ProcessId> next;
+};
 
-        for (int i = p.startTime; i < p.startTime + p.serviceTime; i++)
-        { // put "*" from start time along the service time
-            timeline[i] = "*";
-        }
+struct IndexQueue
+{
+    ProcessId head;
+    ProcessId tail;
+};
 
-        if (mode == "trace")
-        {
-            std::cout << p.name << "     " << "|";
+const IndexQueue EMPTY_QUEUE = {NO_PROCESS, NO_PROCESS};
 
-            for (int t = 0; t <= maxTime - 1; ++t)
-            { // print the string
-                std::cout << timeline[t] << "|";
-            }
-            std::cout << " \n";
+void initPool(QueuePool &pool, int no_of_processes)
+{
+    pool.next.assign(no_of_processes, NO_PROCESS);
+}
 
-            for (int t = 0; t <= maxTime - 1; ++t)
-            { // reset the timeline string
-                timeline[t] = " ";
-            }
-        }
-    }
-    if (mode == "stats")
-    {
-        statPrint(processes, no_of_processes, "FCFS");
-    }
+void pushBack(QueuePool &pool, IndexQueue &queue, ProcessId id)
+{
+    pool.next[id] = NO_PROCESS;
+    if (queue.tail == NO_PROCESS)
+        queue.head = id;
     else
-    {
-        std::cout << "------------------------------------------------\n";
-        std::cout << "\n";
-    }
+        pool.next[queue.tail] = id;
+    queue.tail = id;
 }
 
-bool comp(Process *a, Process *b)
+ProcessId popFront(QueuePool &pool, IndexQueue &queue)
 {
-    return a->serviceTime < b->serviceTime;
+    ProcessId id = queue.head;
+    queue.head = pool.next[id];
+    if (queue.head == NO_PROCESS)
+        queue.tail = NO_PROCESS;
+    return id;
 }
 
-void SPN(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes)
+// Blocked processes wait here until their I/O burst is over. Arrival is the
+// first wakeup, so every policy admits new and returning work the same way.
+// Slots are hashed by wake time; an entry more than one revolution away just
+// stays in its slot until its round comes up.
+struct TimerWheel
 {
-    int currentTime = 0;
-    int completedProcesses = 0;
-    std::vector<std::string> timeline(simulationTime, " ");
-    std::vector<Process *> x;
+    std::vector<IndexQueue> slots;
+    QueuePool links;
+    int now; // last tick already expired
+};
 
-    for (auto &process : processes)
+void parkProcess(TimerWheel &wheel, std::vector<Process> &processes, ProcessId id, int wakeTime)
+{
+    processes[id].wakeTime = wakeTime;
+    pushBack(wheel.links, wheel.slots[wakeTime % wheel.slots.size()], id);
+}
+
+void initWheel(TimerWheel &wheel, std::vector<Process> &processes)
+{
+    int size = 16;
+    for (const auto &process : processes)
     {
-        process.timeline.resize(simulationTime, ' ');
-        process.startTime = -1;
+        for (int b = 1; b < process.bursts.size(); b += 2)
+        {
+            size = std::max(size, process.bursts[b] + 1);
+        }
     }
+    wheel.slots.assign(size, EMPTY_QUEUE);
+    initPool(wheel.links, processes.size());
+    wheel.now = -1;
 
-    while (completedProcesses < no_of_processes)
+    for (ProcessId id = 0; id < processes.size(); id++)
     {
+        parkProcess(wheel, processes, id, processes[id].arrivalTime);
+    }
+}
 
-        for (int i = 0; i < no_of_processes; i++)
+// Hands back, in wake-time order, every process that became ready up to currentTime.
+void expireTimers(TimerWheel &wheel, std::vector<Process> &processes, int currentTime, std::vector<ProcessId> &woken)
+{
+    woken.clear();
+    while (wheel.now < currentTime)
+    {
+        wheel.now++;
+        IndexQueue &slot = wheel.slots[wheel.now % wheel.slots.size()];
+        IndexQueue later = EMPTY_QUEUE;
+        while (slot.head != NO_PROCESS)
         {
-            if (processes[i].arrivalTime <= currentTime && processes[i].startTime == -1)
+            ProcessId id = popFront(wheel.links, slot);
+            if (processes[id].wakeTime <= wheel.now)
             {
-                x.push_back(&processes[i]);
+                processes[id].readyTime = processes[id].wakeTime;
+                woken.push_back(id);
+            }
+            else
+            {
+                pushBack(wheel.links, later, id);
             }
         }
+        slot = later;
+    }
+}
 
-        // sort vector x according to arrival time
-        std::sort(x.begin(), x.end(), comp);
-
-        for (int i = 0; i < x.size(); i++)
+// True when some process would be handed back by expireTimers(currentTime).
+bool timersDue(TimerWheel &wheel, std::vector<Process> &processes, int currentTime)
+{
+    for (int t = wheel.now + 1; t <= currentTime && t <= wheel.now + (int)wheel.slots.size(); t++)
+    {
+        for (ProcessId id = wheel.slots[t % wheel.slots.size()].head; id != NO_PROCESS; id = wheel.links.next[id])
         {
-            if (!x.empty())
+            if (processes[id].wakeTime <= currentTime)
             {
-
-                Process *currentProcess = x.front();
-                x.erase(x.begin());
-
-                currentProcess->startTime = currentTime;
-                for (int i = 0; i < currentProcess->serviceTime; ++i)
-                {
-                    currentProcess->timeline[currentTime] = '*';
-
-                    for (auto &process : processes)
-                    {
-                        if (process.startTime == -1 && process.arrivalTime <= currentTime)
-                        {
-                            process.timeline[currentTime] = '.';
-                        }
-                    }
-
-                    currentTime++;
-                }
-                currentProcess->finishTime = currentTime;
-                completedProcesses++;
+                return true;
             }
-            else
+        }
+    }
+    return false;
+}
+
+// Earliest wake time still parked in the wheel, or -1 when it is empty. The
+// first slot of the coming revolution holding an entry due in that very
+// revolution has it, so a short gap costs a few slots; only an entry more
+// than a revolution away needs a scan of the whole wheel.
+int nextWakeTime(TimerWheel &wheel, std::vector<Process> &processes)
+{
+    int size = wheel.slots.size();
+    for (int t = wheel.now + 1; t <= wheel.now + size; t++)
+    {
+        for (ProcessId id = wheel.slots[t % size].head; id != NO_PROCESS; id = wheel.links.next[id])
+        {
+            if (processes[id].wakeTime == t)
             {
-                for (auto &process : processes)
-                {
-                    if (process.arrivalTime <= currentTime && process.startTime == -1)
-                    {
-                        process.timeline[currentTime] = '.';
-                    }
-                }
-                currentTime++;
+                return t;
             }
         }
     }
 
-    if (mode == "trace")
+    int earliest = -1;
+    for (const IndexQueue &slot : wheel.slots)
     {
-        tracePrint(processes, no_of_processes, "SPN   ", simulationTime);
+        for (ProcessId id = slot.head; id != NO_PROCESS; id = wheel.links.next[id])
+        {
+            if (earliest == -1 || processes[id].wakeTime < earliest)
+            {
+                earliest = processes[id].wakeTime;
+            }
+        }
     }
-    else if (mode == "stats")
+    return earliest;
+}
+
+// Time an idle cpu moves on to: straight to the next wakeup rather than one
+// tick at a time, so a far-off arrival does not cost a step per idle tick.
+// Nothing is due before it, so the wheel can skip ahead too.
+int skipIdle(TimerWheel &wheel, std::vector<Process> &processes, int currentTime)
+{
+    int wake = nextWakeTime(wheel, processes);
+    if (wake <= currentTime)
     {
-        statPrint(processes, no_of_processes, "SPN");
+        return currentTime + 1;
     }
+    wheel.now = wake - 1;
+    return wake;
 }
 
-bool highestResponseRatio(Process *a, Process *b)
+// The three things advise mode trades off for one run.
+struct Objectives
 {
-    return a->ratio > b->ratio;
-}
+    double meanTurnaround;
+    double p99NormTurn;
+    int switches;
+};
 
-void HRRN(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes)
+// Buffers a policy run needs besides the processes themselves. Each thread
+// keeps one and every run borrows it, so back to back runs (server mode
+// answers many small requests per thread) reuse the capacity of the last one.
+struct Workspace
 {
+    TimerWheel wheel;
+    QueuePool pool;
+    std::vector<ProcessId> woken;
+    std::vector<ProcessId> ready;
+    std::vector<int> admitted;
+    std::vector<IndexQueue> levels;
+
+    int switches;          // times the cpu went to a different process
+    const Process *lastRun;
+
+    // Set by advise mode: the run gives up once its lower bounds are
+    // dominated by a member of front, and says so in pruned.
+    const std::vector<Objectives> *front = nullptr;
+    int nextCheck;
+    bool pruned;
+};
 
-    int currentTime = 0;
-    int completedProcesses = 0;
-    std::vector<Process *> x;
-    std::vector<std::string> timeline(simulationTime, " ");
+Workspace &workspace()
+{
+    static thread_local Workspace work;
+    return work;
+}
 
+// Clears whatever the previous policy left behind so policies can run back to back.
+void resetRun(std::vector<Process> &processes)
+{
     for (auto &process : processes)
     {
-        process.timeline.resize(simulationTime, ' ');
+        // one response and at least one run per cpu burst, one block per I/O
+        // burst: reserved here so recording a schedule seldom allocates
+        int cpuBursts = (process.bursts.size() + 1) / 2;
+        process.runs.clear();
+        process.runs.reserve(cpuBursts);
+        process.blocks.clear();
+        process.blocks.reserve(process.bursts.size() / 2);
         process.startTime = -1;
+        process.finishTime = -1;
+        process.remainingTime = process.serviceTime;
+        process.burst = 0;
+        process.burstLeft = process.bursts[0];
+        process.readyTime = process.arrivalTime;
+        process.responses.clear();
+        process.responses.reserve(cpuBursts);
+        process.i = -1;
+        process.quantum = 0;
     }
 
-    while (completedProcesses < no_of_processes)
-    {
+    Workspace &work = workspace();
+    work.switches = 0;
+    work.lastRun = nullptr;
+    work.nextCheck = 0;
+    work.pruned = false;
+}
 
-        for (int i = 0; i < no_of_processes; i++)
+// Gives the cpu to p for the tick starting at currentTime.
+void runTick(Process *p, int currentTime)
+{
+    if (p->burstLeft == p->bursts[p->burst])
+    {
+        p->responses.push_back(currentTime - p->readyTime);
+        if (p->startTime == -1)
         {
-            if (processes[i].arrivalTime <= currentTime && processes[i].startTime == -1)
-            {
-                x.push_back(&processes[i]);
-                processes[i].waitTime = currentTime - processes[i].arrivalTime;
-                processes[i].ratio = float((processes[i].waitTime + processes[i].serviceTime) / float(processes[i].serviceTime));
-            }
+            p->startTime = currentTime;
         }
+    }
+    if (!p->runs.empty() && p->runs.back().end == currentTime)
+    {
+        p->runs.back().end++;
+    }
+    else
+    {
+        p->runs.push_back({currentTime, currentTime + 1});
 
-        // sort vector x according to response ratio
-        std::sort(x.begin(), x.end(), highestResponseRatio);
+        Workspace &work = workspace();
+        work.switches += work.lastRun != nullptr && work.lastRun != p;
+        work.lastRun = p;
+    }
+    p->burstLeft--;
+    p->remainingTime--;
+}
 
-        if (!x.empty())
+// Objectives of the run so far, as lower bounds for the finished run. An
+// unfinished process needs at least its remaining cpu time from currentTime
+// on, and as they share one cpu the k-th of them to finish waits for at least
+// the k smallest remaining cpu times. Exact once every process has finished.
+Objectives runObjectives(std::vector<Process> &processes, int currentTime, int switches)
+{
+    std::vector<double> normTurn;
+    std::vector<int> remaining;
+    long long finished = 0;
+    long long alone = 0;
+    long long arrivals = 0;
+    for (const auto &process : processes)
+    {
+        int finish = process.finishTime;
+        if (finish == -1)
         {
-            Process *currentProcess = x.front();
-            x.erase(x.begin());
-
-            currentProcess->startTime = currentTime;
-            for (int i = 0; i < currentProcess->serviceTime; ++i)
-            {
-                currentProcess->timeline[currentTime] = '*';
-
-                for (auto &process : processes)
-                {
-                    if (process.startTime == -1 && process.arrivalTime <= currentTime)
-                    {
-                        process.timeline[currentTime] = '.';
-                    }
-                }
-
-                currentTime++;
-            }
-            currentProcess->finishTime = currentTime;
-            completedProcesses++;
-            x.clear();
+            finish = std::max(currentTime, process.arrivalTime) + process.remainingTime;
+            remaining.push_back(process.remainingTime);
+            alone += finish;
+            arrivals += process.arrivalTime;
         }
         else
         {
-            for (auto &process : processes)
-            {
-                if (process.arrivalTime <= currentTime && process.startTime == -1)
-                {
-                    process.timeline[currentTime] = '.';
-                }
-            }
-            currentTime++;
+            finished += finish - process.arrivalTime;
         }
+        normTurn.push_back(double(finish - process.arrivalTime) / process.serviceTime);
     }
 
-    if (mode == "trace")
-    {
-        tracePrint(processes, no_of_processes, "HRRN  ", simulationTime);
-    }
-    else if (mode == "stats")
+    std::sort(remaining.begin(), remaining.end());
+    long long queued = 0;
+    long long work = 0;
+    for (int left : remaining)
     {
-        statPrint(processes, no_of_processes, "HRRN");
+        work += left;
+        queued += currentTime + work;
     }
+    long long total = finished + std::max(alone, queued) - arrivals;
+
+    // nearest-rank 99th percentile
+    int rank = std::max(int(std::ceil(0.99 * normTurn.size())), 1);
+    std::nth_element(normTurn.begin(), normTurn.begin() + rank - 1, normTurn.end());
+    return {double(total) / processes.size(), normTurn[rank - 1], switches};
 }
 
-bool shortestRemainingTime(Process *a, Process *b)
+// a is no worse than b in every objective and better in at least one
+bool dominates(const Objectives &a, const Objectives &b)
 {
-    return a->remainingTime < b->remainingTime;
+    bool noWorse = a.meanTurnaround <= b.meanTurnaround && a.p99NormTurn <= b.p99NormTurn && a.switches <= b.switches;
+    bool better = a.meanTurnaround < b.meanTurnaround || a.p99NormTurn < b.p99NormTurn || a.switches < b.switches;
+    return noWorse && better;
 }
 
-void SRT(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes)
+// Checked by every policy loop. Outside advise mode this is a single test;
+// inside it the bounds are recomputed about once per no_of_processes ticks.
+bool dominatedSoFar(std::vector<Process> &processes, int currentTime)
 {
-    int currentTime = 0;
-    int completedProcesses = 0;
-    std::vector<std::string> timeline(simulationTime, " ");
-    std::vector<Process *> readyQueue;
-
-    for (auto &process : processes)
+    Workspace &work = workspace();
+    if (work.front == nullptr || currentTime < work.nextCheck)
     {
-        process.timeline.resize(simulationTime, ' ');
-        process.startTime = -1;
-        process.remainingTime = process.serviceTime;
+        return false;
     }
+    work.nextCheck = currentTime + std::max(int(processes.size()), 16);
 
-    while (completedProcesses < no_of_processes)
+    Objectives bound = runObjectives(processes, currentTime, work.switches);
+    for (const Objectives &best : *work.front)
     {
-        for (auto &process : processes)
+        if (dominates(best, bound))
         {
-            if (process.arrivalTime <= currentTime && process.startTime == -1)
-            {
-                readyQueue.push_back(&process);
-                process.startTime = 0;
-            }
+            work.pruned = true;
+            return true;
         }
+    }
+    return false;
+}
 
-        readyQueue.erase(
-            std::remove_if(readyQueue.begin(), readyQueue.end(),
-                           [](Process *p)
-                           { return p->remainingTime <= 0; }),
-            readyQueue.end());
+// Called once the cpu burst of process id ran out at currentTime. Returns
+// true when the process is complete; otherwise it blocks for its next I/O
+// burst and sits in the wheel until the wakeup re-admits it.
+bool finishBurst(std::vector<Process> &processes, ProcessId id, int currentTime, TimerWheel &wheel)
+{
+    Process *p = &processes[id];
+    int io = p->burst + 1 < p->bursts.size() ? p->bursts[p->burst + 1] : 0;
+    if (io > 0)
+    {
+        p->blocks.push_back({currentTime, currentTime + io});
+    }
 
-        std::sort(readyQueue.begin(), readyQueue.end(), shortestRemainingTime);
+    if (p->burst + 2 >= p->bursts.size())
+    {
+        p->finishTime = currentTime + io; // a trailing I/O burst still counts towards turnaround
+        return true;
+    }
+    p->burst += 2;
+    p->burstLeft = p->bursts[p->burst];
+    parkProcess(wheel, processes, id, currentTime + io);
+    return false;
+}
 
-        if (!readyQueue.empty())
+void FCFS(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes)
+{
+    int currentTime = 0;
+    int completedProcesses = 0;
+    Workspace &work = workspace();
+    QueuePool &pool = work.pool;
+    IndexQueue queue = EMPTY_QUEUE;
+    std::vector<ProcessId> &woken = work.woken;
+    TimerWheel &wheel = work.wheel;
+
+    resetRun(processes);
+    initPool(pool, no_of_processes);
+    initWheel(wheel, processes);
+    woken.reserve(no_of_processes);
+
+    while (completedProcesses < no_of_processes && !dominatedSoFar(processes, currentTime))
+    {
+        expireTimers(wheel, processes, currentTime, woken);
+        for (ProcessId id : woken)
         {
-            Process *currentProcess = readyQueue.front();
+            pushBack(pool, queue, id);
+        }
 
-            currentProcess->timeline[currentTime] = '*';
-            currentProcess->remainingTime--;
+        if (queue.head != NO_PROCESS)
+        {
+            // the head of the queue keeps the cpu until its burst is over
+            Process *currentProcess = &processes[queue.head];
+            runTick(currentProcess, currentTime);
+            currentTime++;
 
-            for (auto &process : processes)
+            if (currentProcess->burstLeft <= 0)
             {
-                if (process.startTime == 0 && process.remainingTime > 0 && process.timeline[currentTime] == ' ')
-                {
-                    process.timeline[currentTime] = '.';
-                }
+                completedProcesses += finishBurst(processes, popFront(pool, queue), currentTime, wheel);
             }
+        }
+        else
+        {
+            currentTime = skipIdle(wheel, processes, currentTime);
+        }
+    }
+
+    report(processes, mode, "FCFS", simulationTime);
+}
+
+bool comp(Process *a, Process *b)
+{
+    return a->burstLeft < b->burstLeft;
+}
+
+void SPN(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes)
+{
+    int currentTime = 0;
+    int completedProcesses = 0;
+    Workspace &work = workspace();
+    std::vector<ProcessId> &x = work.ready;
+    std::vector<ProcessId> &woken = work.woken;
+    TimerWheel &wheel = work.wheel;
+
+    resetRun(processes);
+    initWheel(wheel, processes);
+    x.clear();
+    x.reserve(no_of_processes);
+    woken.reserve(no_of_processes);
+
+    while (completedProcesses < no_of_processes && !dominatedSoFar(processes, currentTime))
+    {
+        expireTimers(wheel, processes, currentTime, woken);
+        x.insert(x.end(), woken.begin(), woken.end());
 
-            if (currentProcess->remainingTime == 0)
+        if (!x.empty())
+        {
+            // shortest next cpu burst first, earliest admitted on ties
+            auto next = std::min_element(x.begin(), x.end(), [&processes](ProcessId a, ProcessId b)
+                                         { return comp(&processes[a], &processes[b]); });
+            ProcessId id = *next;
+            Process *currentProcess = &processes[id];
+            x.erase(next);
+
+            while (currentProcess->burstLeft > 0)
             {
-                currentProcess->finishTime = currentTime + 1;
-                completedProcesses++;
+                runTick(currentProcess, currentTime);
+                currentTime++;
             }
+            completedProcesses += finishBurst(processes, id, currentTime, wheel);
         }
         else
         {
-            for (auto &process : processes)
+            currentTime = skipIdle(wheel, processes, currentTime);
+        }
+    }
+
+    report(processes, mode, "SPN", simulationTime);
+}
+
+bool highestResponseRatio(Process *a, Process *b)
+{
+    return a->ratio > b->ratio;
+}
+
+void HRRN(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes)
+{
+
+    int currentTime = 0;
+    int completedProcesses = 0;
+    Workspace &work = workspace();
+    std::vector<ProcessId> &x = work.ready;
+    std::vector<ProcessId> &woken = work.woken;
+    TimerWheel &wheel = work.wheel;
+
+    resetRun(processes);
+    initWheel(wheel, processes);
+    x.clear();
+    x.reserve(no_of_processes);
+    woken.reserve(no_of_processes);
+
+    while (completedProcesses < no_of_processes && !dominatedSoFar(processes, currentTime))
+    {
+        expireTimers(wheel, processes, currentTime, woken);
+        x.insert(x.end(), woken.begin(), woken.end());
+
+        if (!x.empty())
+        {
+            for (ProcessId id : x)
             {
-                if (process.startTime == 0 && process.remainingTime > 0)
-                {
-                    process.timeline[currentTime] = '.';
-                }
+                Process &process = processes[id];
+                process.waitTime = currentTime - process.readyTime;
+                process.ratio = float((process.waitTime + process.burstLeft) / float(process.burstLeft));
             }
-        }
 
-        currentTime++;
+            // highest response ratio first, earliest admitted on ties
+            auto next = std::min_element(x.begin(), x.end(), [&processes](ProcessId a, ProcessId b)
+                                         { return highestResponseRatio(&processes[a], &processes[b]); });
+            ProcessId id = *next;
+            Process *currentProcess = &processes[id];
+            x.erase(next);
+
+            while (currentProcess->burstLeft > 0)
+            {
+                runTick(currentProcess, currentTime);
+                currentTime++;
+            }
+            completedProcesses += finishBurst(processes, id, currentTime, wheel);
+        }
+        else
+        {
+            currentTime = skipIdle(wheel, processes, currentTime);
+        }
     }
 
-    if (mode == "trace")
+    report(processes, mode, "HRRN", simulationTime);
+}
+
+bool shortestRemainingTime(Process *a, Process *b)
+{
+    return a->burstLeft < b->burstLeft;
+}
+
+void SRT(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes)
+{
+    int currentTime = 0;
+    int completedProcesses = 0;
+    int admissions = 0;
+    Workspace &work = workspace();
+    std::vector<ProcessId> &readyQueue = work.ready; // binary heap, the next to run on top
+    std::vector<int> &admitted = work.admitted;
+    std::vector<ProcessId> &woken = work.woken;
+    TimerWheel &wheel = work.wheel;
+
+    // shortest remaining burst first, earliest admitted on ties
+    auto runsAfter = [&processes, &admitted](ProcessId a, ProcessId b)
     {
-        tracePrint(processes, no_of_processes, "SRT   ", simulationTime);
-    }
-    else if (mode == "stats")
+        if (processes[a].burstLeft != processes[b].burstLeft)
+            return shortestRemainingTime(&processes[b], &processes[a]);
+        return admitted[a] > admitted[b];
+    };
+
+    resetRun(processes);
+    initWheel(wheel, processes);
+    readyQueue.clear();
+    readyQueue.reserve(no_of_processes);
+    admitted.assign(no_of_processes, 0);
+    woken.reserve(no_of_processes);
+
+    while (completedProcesses < no_of_processes && !dominatedSoFar(processes, currentTime))
     {
-        statPrint(processes, no_of_processes, "SRT");
+        expireTimers(wheel, processes, currentTime, woken);
+        for (ProcessId id : woken)
+        {
+            admitted[id] = admissions++;
+            readyQueue.push_back(id);
+            std::push_heap(readyQueue.begin(), readyQueue.end(), runsAfter);
+        }
+
+        if (!readyQueue.empty())
+        {
+            // running only shortens the top entry's burst, so it stays on top
+            ProcessId id = readyQueue.front();
+            Process *currentProcess = &processes[id];
+            runTick(currentProcess, currentTime);
+
+            if (currentProcess->burstLeft <= 0)
+            {
+                std::pop_heap(readyQueue.begin(), readyQueue.end(), runsAfter);
+                readyQueue.pop_back();
+                completedProcesses += finishBurst(processes, id, currentTime + 1, wheel);
+            }
+        }
+        else
+        {
+            currentTime = skipIdle(wheel, processes, currentTime);
+            continue;
+        }
+
+        currentTime++;
     }
+
+    report(processes, mode, "SRT", simulationTime);
 }
 
 void RoundRobin(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes, int quantum)
@@ -444,110 +1053,73 @@ void RoundRobin(std::vector<Process> &processes, std::string mode, int simulatio
     int mainQ = quantum;
     int currentTime = 0;
     int completedProcesses = 0;
-    std::vector<int> temp;
-    std::queue<Process *> queue;
-    std::vector<std::string> timeline(simulationTime, " ");
-
-    for (auto &process : processes)
-    {
-        temp.push_back(process.serviceTime);
-    }
-
-    for (auto &process : processes)
-    {
-        process.timeline.resize(simulationTime, ' ');
-        process.startTime = -1;
-    }
-
-    while (completedProcesses < no_of_processes)
+    Workspace &work = workspace();
+    QueuePool &pool = work.pool;
+    IndexQueue queue = EMPTY_QUEUE;
+    std::vector<ProcessId> &woken = work.woken;
+    TimerWheel &wheel = work.wheel;
+
+    resetRun(processes);
+    initPool(pool, no_of_processes);
+    initWheel(wheel, processes);
+    woken.reserve(no_of_processes);
+
+    while (completedProcesses < no_of_processes && !dominatedSoFar(processes, currentTime))
     {
-        for (auto &process : processes)
+        expireTimers(wheel, processes, currentTime, woken);
+        for (ProcessId id : woken)
         {
-            if (process.arrivalTime <= currentTime && process.startTime == -1)
-            {
-                queue.push(&process);
-                process.startTime = currentTime;
-            }
+            pushBack(pool, queue, id);
         }
 
-        if (!queue.empty())
+        if (queue.head != NO_PROCESS)
         {
-            Process *currentProcess = queue.front();
-            queue.pop();
+            ProcessId id = popFront(pool, queue);
+            Process *currentProcess = &processes[id];
             quantum = mainQ;
 
-            while (quantum > 0 && currentProcess->serviceTime > 0)
+            while (quantum > 0 && currentProcess->burstLeft > 0)
             {
-                currentProcess->timeline[currentTime] = '*';
-
-                for (auto &process : processes)
-                {
-                    if (process.serviceTime > 0 && &process != currentProcess && process.arrivalTime <= currentTime)
-                    {
-                        process.timeline[currentTime] = '.';
-                    }
-                }
-
+                runTick(currentProcess, currentTime);
                 currentTime++;
-                currentProcess->serviceTime--;
                 quantum--;
 
-                for (auto &process : processes)
+                // newcomers queue up ahead of the process being preempted
+                expireTimers(wheel, processes, currentTime, woken);
+                for (ProcessId woke : woken)
                 {
-                    if (process.arrivalTime == currentTime && process.startTime == -1)
-                    {
-                        queue.push(&process);
-                        process.startTime = currentTime;
-                    }
+                    pushBack(pool, queue, woke);
                 }
             }
 
-            if (currentProcess->serviceTime > 0)
+            if (currentProcess->burstLeft > 0)
             {
-                queue.push(currentProcess);
+                pushBack(pool, queue, id);
             }
             else
             {
-                currentProcess->finishTime = currentTime;
-                completedProcesses++;
+                completedProcesses += finishBurst(processes, id, currentTime, wheel);
             }
         }
         else
         {
-            currentTime++;
+            currentTime = skipIdle(wheel, processes, currentTime);
         }
     }
 
-    if (mode == "trace")
-    {
-        std::cout << "RR-" << mainQ << "  ";
-        for (int i = 0; i <= simulationTime; ++i)
-        {
-            std::cout << i % 10 << " ";
-        }
-        std::cout << std::endl;
-        std::cout << "------------------------------------------------" << std::endl;
+    report(processes, mode, "RR-" + std::to_string(mainQ), simulationTime);
+}
 
-        for (const auto &process : processes)
-        {
-            std::cout << process.name << "     ";
-            for (int t = 0; t < simulationTime; t++)
-            {
-                std::cout << "|" << process.timeline[t];
-            }
-            std::cout << "| \n";
-        }
-        std::cout << "------------------------------------------------\n";
-        std::cout << "\n";
-    }
-    else if (mode == "stats")
+// Upper bound on the feedback levels a run can reach: a process is demoted
+// at most once per tick of cpu it receives.
+int maxFeedbackLevels(std::vector<Process> &processes)
+{
+    int levels = 1;
+    for (const auto &process : processes)
     {
-        for (int i = 0; i < no_of_processes; i++)
-        {
-            processes[i].serviceTime = temp[i];
-        }
-        statPrint(processes, no_of_processes, "RR-" + std::to_string(mainQ));
+        levels = std::max(levels, process.serviceTime + 1);
     }
+    return levels;
 }
 
 void FB1(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes)
@@ -555,101 +1127,80 @@ void FB1(std::vector<Process> &processes, std::string mode, int simulationTime,
     int currentTime = 0;
     int completedProcesses = 0;
     bool flag = 0;
-    std::vector<int> temp;
-    std::vector<std::vector<Process *>> listOfQueues;
-    listOfQueues.emplace_back();
-    std::vector<std::string> timeline(simulationTime, " ");
-
-    for (auto &process : processes)
-    {
-        temp.push_back(process.serviceTime);
-    }
-
-    for (auto &process : processes)
-    {
-        process.timeline.resize(simulationTime, ' ');
-        process.startTime = -1;
-        process.i = -1;
-        process.quantum = 0;
-    }
-
-    while (completedProcesses < no_of_processes)
+    Workspace &work = workspace();
+    QueuePool &pool = work.pool;
+    std::vector<IndexQueue> &listOfQueues = work.levels;
+    std::vector<ProcessId> &woken = work.woken;
+    TimerWheel &wheel = work.wheel;
+
+    resetRun(processes);
+    initPool(pool, no_of_processes);
+    initWheel(wheel, processes);
+    listOfQueues.clear();
+    listOfQueues.reserve(maxFeedbackLevels(processes));
+    listOfQueues.push_back(EMPTY_QUEUE);
+    woken.reserve(no_of_processes);
+
+    while (completedProcesses < no_of_processes && !dominatedSoFar(processes, currentTime))
     {
-        for (auto &process : processes)
+        expireTimers(wheel, processes, currentTime, woken);
+        for (ProcessId id : woken)
         {
-            if (process.arrivalTime <= currentTime && process.startTime == -1 && process.i == -1)
+            // newcomers start at the top, returning processes keep their level
+            if (processes[id].i == -1)
             {
-                listOfQueues[0].push_back(&process);
-                process.i = 0;
+                processes[id].i = 0;
             }
+            pushBack(pool, listOfQueues[processes[id].i], id);
         }
 
+        bool ran = false;
         for (int k = 0; k < listOfQueues.size(); k++)
         {
-            if (!listOfQueues[k].empty())
+            if (listOfQueues[k].head != NO_PROCESS)
             {
-                Process *currentProcess = listOfQueues[k].front();
+                ProcessId id = listOfQueues[k].head;
+                Process *currentProcess = &processes[id];
 
-                currentProcess->startTime = currentTime;
-
-                currentProcess->timeline[currentTime] = '*';
+                runTick(currentProcess, currentTime);
                 currentTime++;
-                currentProcess->serviceTime--;
 
-                for (auto &queue : listOfQueues)
+                // a process is not demoted until some other process has shown up
+                if (timersDue(wheel, processes, currentTime))
                 {
-                    for (auto &processPtr : queue)
-                    {
-                        if (processPtr->serviceTime > 0 && processPtr->startTime != currentTime)
-                        {
-                            processPtr->timeline[currentTime] = '.';
-                        }
-                    }
+                    flag = 1;
                 }
 
-                for (auto &process : processes)
+                if (currentProcess->burstLeft <= 0)
                 {
-                    if (process.arrivalTime <= currentTime && process.startTime == -1 && process.i == -1)
-                    {
-                        flag = 1;
-                    }
+                    popFront(pool, listOfQueues[k]);
+                    completedProcesses += finishBurst(processes, id, currentTime, wheel);
                 }
-
-                if (currentProcess->serviceTime > 0 && flag == 1)
+                else if (flag == 1)
                 {
-                    listOfQueues[k].erase(listOfQueues[k].begin());
+                    popFront(pool, listOfQueues[k]);
 
                     if ((k + 1) >= listOfQueues.size())
                     {
-                        listOfQueues.emplace_back();
+                        listOfQueues.push_back(EMPTY_QUEUE);
                     }
-                    listOfQueues[k + 1].push_back(currentProcess);
-                }
-                else if (currentProcess->serviceTime == 0)
-                {
-                    currentProcess->finishTime = currentTime;
-                    completedProcesses++;
-                    listOfQueues[k].erase(listOfQueues[k].begin());
+                    pushBack(pool, listOfQueues[k + 1], id);
+                    currentProcess->i = k + 1;
                 }
+                ran = true;
                 break;
             }
         }
-    }
-
-    //--------------------------------------------------------------------------
 
-    if (mode == "trace")
-    {
-        tracePrint(processes, no_of_processes, "FB-1  ", simulationTime);
-    }
-    else if (mode == "stats")
-    {
-        for (int i = 0; i < no_of_processes; i++)
+        if (!ran)
         {
-            processes[i].serviceTime = temp[i];
+            currentTime = skipIdle(wheel, processes, currentTime);
         }
-        statPrint(processes, no_of_processes, "FB-1");
     }
+
+    //--------------------------------------------------------------------------
+
+    report(processes, mode, "FB-1", simulationTime);
 }
 
 void FB2i(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes)
@@ -657,218 +1208,1571 @@ void FB2i(std::vector<Process> &processes, std::string mode, int simulationTime,
     int currentTime = 0;
     int completedProcesses = 0;
     bool flag = 0;
-    std::vector<int> temp;
-    std::vector<std::vector<Process *>> listOfQueues;
-    listOfQueues.emplace_back();
-    std::vector<std::string> timeline(simulationTime, " ");
-
-    for (auto &process : processes)
-    {
-        temp.push_back(process.serviceTime);
-    }
-
-    for (auto &process : processes)
-    {
-        process.timeline.resize(simulationTime, ' ');
-        process.startTime = -1;
-        process.i = -1;
-        process.quantum = 0;
-    }
-
-    while (completedProcesses < no_of_processes)
+    Workspace &work = workspace();
+    QueuePool &pool = work.pool;
+    std::vector<IndexQueue> &listOfQueues = work.levels;
+    std::vector<ProcessId> &woken = work.woken;
+    TimerWheel &wheel = work.wheel;
+
+    resetRun(processes);
+    initPool(pool, no_of_processes);
+    initWheel(wheel, processes);
+    listOfQueues.clear();
+    listOfQueues.reserve(maxFeedbackLevels(processes));
+    listOfQueues.push_back(EMPTY_QUEUE);
+    woken.reserve(no_of_processes);
+
+    while (completedProcesses < no_of_processes && !dominatedSoFar(processes, currentTime))
     {
-        for (auto &process : processes)
+        expireTimers(wheel, processes, currentTime, woken);
+        for (ProcessId id : woken)
         {
-            if (process.arrivalTime <= currentTime && process.startTime == -1 && process.i == -1)
+            // newcomers start at the top, returning processes keep their level
+            Process &process = processes[id];
+            if (process.i == -1)
             {
-                listOfQueues[0].push_back(&process);
                 process.i = 0;
-                process.quantum = 1;
             }
+            process.quantum = pow(2, process.i);
+            pushBack(pool, listOfQueues[process.i], id);
         }
 
+        bool ran = false;
         for (int k = 0; k < listOfQueues.size(); k++)
         {
-            if (!listOfQueues[k].empty())
+            if (listOfQueues[k].head != NO_PROCESS)
             {
-                Process *currentProcess = listOfQueues[k].front();
-
-                currentProcess->startTime = currentTime;
+                ProcessId id = listOfQueues[k].head;
+                Process *currentProcess = &processes[id];
 
-                while (currentProcess->quantum > 0 && currentProcess->serviceTime > 0)
+                while (currentProcess->quantum > 0 && currentProcess->burstLeft > 0)
                 {
-                    currentProcess->timeline[currentTime] = '*';
-
-                    for (auto &process : processes)
-                    {
-                        if (process.serviceTime > 0 && &process != currentProcess && process.arrivalTime <= currentTime)
-                        {
-                            process.timeline[currentTime] = '.';
-                        }
-                    }
+                    runTick(currentProcess, currentTime);
                     currentTime++;
-                    currentProcess->serviceTime--;
                     currentProcess->quantum--;
                 }
 
-                for (auto &process : processes)
+                if (timersDue(wheel, processes, currentTime))
                 {
-                    if (process.arrivalTime <= currentTime && process.startTime == -1 && process.i == -1)
-                    {
-                        flag = 1;
-                    }
+                    flag = 1;
                 }
 
-                if (currentProcess->serviceTime > 0 && flag == 1)
+                if (currentProcess->burstLeft <= 0)
+                {
+                    popFront(pool, listOfQueues[k]);
+                    completedProcesses += finishBurst(processes, id, currentTime, wheel);
+                }
+                else if (flag == 1)
                 {
                     currentProcess->i++;
                     currentProcess->quantum = pow(2, currentProcess->i);
-                    listOfQueues[k].erase(listOfQueues[k].begin());
+                    popFront(pool, listOfQueues[k]);
 
                     if ((k + 1) >= listOfQueues.size())
                     {
-                        listOfQueues.emplace_back();
+                        listOfQueues.push_back(EMPTY_QUEUE);
                     }
-                    listOfQueues[k + 1].push_back(currentProcess);
-                }
-                else if (currentProcess->serviceTime <= 0)
-                {
-                    currentProcess->finishTime = currentTime;
-                    completedProcesses++;
-                    listOfQueues[k].erase(listOfQueues[k].begin());
+                    pushBack(pool, listOfQueues[k + 1], id);
                 }
                 else
                 {
                     currentProcess->quantum = pow(2, currentProcess->i);
                 }
+                ran = true;
                 break;
             }
         }
-    }
 
-    //--------------------------------------------------------------------------
-
-    if (mode == "trace")
-    {
-        tracePrint(processes, no_of_processes, "FB-2i ", simulationTime);
-    }
-    else if (mode == "stats")
-    {
-        for (int i = 0; i < no_of_processes; i++)
+        if (!ran)
         {
-            processes[i].serviceTime = temp[i];
+            currentTime = skipIdle(wheel, processes, currentTime);
         }
-        statPrint(processes, no_of_processes, "FB-2i");
     }
-}
 
-int main()
-{
-    std::string mode;
-    std::vector<std::string> policies;
-    int simulationTime;
-    int no_of_processes;
-    std::vector<Process> processes;
-    std::string num;
-    std::vector<int> quantum;
+    //--------------------------------------------------------------------------
 
-    std::string line;
+    report(processes, mode, "FB-2i", simulationTime);
+}
 
-    //Mode
-    std::getline(std::cin, mode);
+// The ready heap (std::push_heap/pop_heap) keeps the "largest" id on top, so
+// these comparators return true when a should run after b.
+bool laterDeadline(Process *a, Process *b)
+{
+    if (absoluteDeadline(*a) != absoluteDeadline(*b))
+        return absoluteDeadline(*a) > absoluteDeadline(*b);
+    if (a->arrivalTime != b->arrivalTime)
+        return a->arrivalTime > b->arrivalTime;
+    return a->name > b->name;
+}
 
-    //Policy
-    std::getline(std::cin, line);
-    std::stringstream ss(line);
-    std::string policy;
+bool longerPeriod(Process *a, Process *b)
+{
+    if (rmPeriod(*a) != rmPeriod(*b))
+        return rmPeriod(*a) > rmPeriod(*b);
+    if (a->arrivalTime != b->arrivalTime)
+        return a->arrivalTime > b->arrivalTime;
+    return a->name > b->name;
+}
 
-    while (std::getline(ss, policy, ','))
+// Every process is one job of a sporadic task: C = serviceTime, T = period
+// (or the deadline when no period is given), D = deadline (or T). The
+// utilization test runs first; rate-monotonic falls back to exact
+// response-time analysis when the Liu & Layland bound is exceeded.
+void schedulabilityPrint(std::vector<Process> &processes, std::string name, bool edf)
+{
+    std::vector<Process *> tasks;
+    for (auto &process : processes)
     {
-        if (policy.find('-') != std::string::npos)
-        {
-            std::stringstream ss_policy(policy);
-            std::string policy_number;
-            std::string quantum_value;
-            std::getline(ss_policy, policy_number, '-');
-            std::getline(ss_policy, quantum_value);
-            policies.push_back(policy_number);
-            quantum.push_back(std::stoi(quantum_value));
-        }
-        else
+        if (rmPeriod(process) != INT_MAX)
         {
-            policies.push_back(policy);
-            quantum.push_back(-1);
+            tasks.push_back(&process);
         }
     }
+    if (tasks.empty())
+    {
+        return;
+    }
 
-    /*
-        std::cout << "Policies extracted:" << std::endl;
-        for (size_t i = 0; i < policies.size(); ++i) {
-            std::cout << "Policy: " << policies[i] << ", Quantum: " << quantum[i] << std::endl;
-        }
-    */
+    float utilization = 0;
+    float density = 0;
+    bool implicitDeadlines = true;
+    for (Process *task : tasks)
+    {
+        int period = rmPeriod(*task);
+        int deadline = task->deadline > 0 ? task->deadline : period;
+        utilization += float(task->serviceTime) / period;
+        density += float(task->serviceTime) / std::min(deadline, period);
+        implicitDeadlines = implicitDeadlines && deadline >= period;
+    }
 
-    //Simulation time
-    std::cin >> simulationTime;
-    std::cin.ignore();
+    std::cout << name << " schedulability\n";
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2) << utilization;
+    if (edf)
+    {
+        bool ok = implicitDeadlines ? utilization <= 1 : density <= 1;
+        std::cout << "Utilization " << oss.str() << " (bound 1.00): "
+                  << (ok ? "schedulable" : implicitDeadlines ? "not schedulable" : "inconclusive") << "\n\n";
+        return;
+    }
 
-    //Number of processes
-    std::cin >> no_of_processes;
-    std::cin.ignore();
+    int n = tasks.size();
+    float bound = n * (std::pow(2.0f, 1.0f / n) - 1);
+    std::ostringstream boundText;
+    boundText << std::fixed << std::setprecision(2) << bound;
+    std::cout << "Utilization " << oss.str() << " (bound " << boundText.str() << ")";
+    if (implicitDeadlines && utilization <= bound)
+    {
+        std::cout << ": schedulable\n\n";
+        return;
+    }
+    std::cout << "\n";
 
-    //Process details
-    for (int i = 0; i < no_of_processes; ++i)
+    std::sort(tasks.begin(), tasks.end(), [](Process *a, Process *b)
+              { return longerPeriod(b, a); });
+    bool ok = true;
+    std::cout << "Response" << "   ";
+    for (int k = 0; k < n; k++)
     {
-        Process p;
-        std::getline(std::cin, line);
-        ss.clear();
-        ss.str(line);
-        std::getline(ss, line, ',');
-        p.name = line[0];
-        std::getline(ss, line, ',');
-        p.arrivalTime = std::stoi(line);
-        std::getline(ss, line, ',');
-        p.serviceTime = std::stoi(line);
-        p.startTime = -1;
-        p.finishTime = -1;
-        processes.push_back(p);
+        int deadline = tasks[k]->deadline > 0 ? tasks[k]->deadline : rmPeriod(*tasks[k]);
+        int response = tasks[k]->serviceTime;
+        int previous = -1;
+        while (response != previous && response <= deadline)
+        {
+            previous = response;
+            response = tasks[k]->serviceTime;
+            for (int j = 0; j < k; j++)
+            {
+                int period = rmPeriod(*tasks[j]);
+                response += (previous + period - 1) / period * tasks[j]->serviceTime;
+            }
+        }
+        ok = ok && response <= deadline;
+        printCenteredText(std::string(1, tasks[k]->name) + ":" + (response <= deadline ? std::to_string(response) : "-"), 5);
     }
+    std::cout << "|\n"
+              << "Response-time test: " << (ok ? "schedulable" : "not schedulable") << "\n\n";
+}
 
+// Preemptive fixed-tick scheduler shared by EDF and RM; the ready heap is
+// ordered by the supplied comparator and re-evaluated every tick.
+void realTimeSchedule(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes,
+                      bool (*runsAfter)(Process *, Process *), std::string name)
+{
+    int currentTime = 0;
+    int completedProcesses = 0;
+    auto order = [&processes, runsAfter](ProcessId a, ProcessId b)
+    { return runsAfter(&processes[a], &processes[b]); };
+    Workspace &work = workspace();
+    std::vector<ProcessId> &readyQueue = work.ready; // binary heap, the next to run on top
+    std::vector<ProcessId> &woken = work.woken;
+    TimerWheel &wheel = work.wheel;
+
+    resetRun(processes);
+    initWheel(wheel, processes);
+    readyQueue.clear();
+    readyQueue.reserve(no_of_processes);
+    woken.reserve(no_of_processes);
 
-    for (int i = 0; i < policies.size(); ++i)
+    if (mode == "stats")
     {
-        const std::string &policy = policies[i];
-        // std::cout << "Policy: " << policy << ", Quantum: " << quantum[i] << "\n";
+        schedulabilityPrint(processes, name, name == "EDF");
+    }
 
-        if (policy == "1")
+    while (completedProcesses < no_of_processes && !dominatedSoFar(processes, currentTime))
+    {
+        expireTimers(wheel, processes, currentTime, woken);
+        for (ProcessId id : woken)
         {
-            FCFS(processes, mode, simulationTime, no_of_processes);
+            readyQueue.push_back(id);
+            std::push_heap(readyQueue.begin(), readyQueue.end(), order);
         }
-        else if (policy == "2")
+
+        if (!readyQueue.empty())
         {
-            RoundRobin(processes, mode, simulationTime, no_of_processes, quantum[i]);
+            std::pop_heap(readyQueue.begin(), readyQueue.end(), order);
+            ProcessId id = readyQueue.back();
+            Process *currentProcess = &processes[id];
+            readyQueue.pop_back();
+            runTick(currentProcess, currentTime);
+
+            if (currentProcess->burstLeft <= 0)
+            {
+                completedProcesses += finishBurst(processes, id, currentTime + 1, wheel);
+            }
+            else
+            {
+                readyQueue.push_back(id);
+                std::push_heap(readyQueue.begin(), readyQueue.end(), order);
+            }
         }
-        else if (policy == "3")
+        else
+        {
+            currentTime = skipIdle(wheel, processes, currentTime);
+            continue;
+        }
+
+        currentTime++;
+    }
+
+    report(processes, mode, name, simulationTime);
+}
+
+// Run queues in the style of the O(1) scheduler: a FIFO per priority level
+// and a bitmap of the non-empty levels, so the highest runnable level is one
+// find-first-set per bitmap word. The levels share one pool of links.
+struct PriorityArray
+{
+    unsigned long long bitmap[(PRIORITY_LEVELS + 63) / 64];
+    IndexQueue queues[PRIORITY_LEVELS];
+    QueuePool links;
+};
+
+void initArray(PriorityArray &array, int no_of_processes)
+{
+    std::fill(array.bitmap, array.bitmap + (PRIORITY_LEVELS + 63) / 64, 0ULL);
+    std::fill(array.queues, array.queues + PRIORITY_LEVELS, EMPTY_QUEUE);
+    initPool(array.links, no_of_processes);
+}
+
+void enqueueTask(PriorityArray &array, std::vector<Process> &processes, ProcessId id)
+{
+    int level = processes[id].priority;
+    pushBack(array.links, array.queues[level], id);
+    array.bitmap[level / 64] |= 1ULL << (level % 64);
+}
+
+void dequeueTask(PriorityArray &array, int level)
+{
+    popFront(array.links, array.queues[level]);
+    if (array.queues[level].head == NO_PROCESS)
+    {
+        array.bitmap[level / 64] &= ~(1ULL << (level % 64));
+    }
+}
+
+// Lowest non-empty level, or -1 when nothing is runnable.
+int highestLevel(PriorityArray &array)
+{
+    for (int word = 0; word < (PRIORITY_LEVELS + 63) / 64; word++)
+    {
+        if (array.bitmap[word] != 0)
+        {
+            return word * 64 + __builtin_ctzll(array.bitmap[word]);
+        }
+    }
+    return -1;
+}
+
+// Preemptive static priority: the head of the highest non-empty level runs,
+// levels are round-robin with the given quantum, and a preempted process
+// keeps its place and the rest of its slice at the head of its level.
+void Priority(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes, int quantum)
+{
+    int mainQ = quantum < 1 ? 1 : quantum;
+    int currentTime = 0;
+    int completedProcesses = 0;
+    static thread_local PriorityArray array;
+    Workspace &work = workspace();
+    std::vector<ProcessId> &woken = work.woken;
+    TimerWheel &wheel = work.wheel;
+
+    resetRun(processes);
+    initArray(array, no_of_processes);
+    initWheel(wheel, processes);
+    woken.reserve(no_of_processes);
+
+    while (completedProcesses < no_of_processes && !dominatedSoFar(processes, currentTime))
+    {
+        expireTimers(wheel, processes, currentTime, woken);
+        for (ProcessId id : woken)
+        {
+            processes[id].quantum = mainQ;
+            enqueueTask(array, processes, id);
+        }
+
+        int level = highestLevel(array);
+        if (level != -1)
+        {
+            ProcessId id = array.queues[level].head;
+            Process *currentProcess = &processes[id];
+            runTick(currentProcess, currentTime);
+            currentProcess->quantum--;
+
+            if (currentProcess->burstLeft <= 0)
+            {
+                dequeueTask(array, level);
+                completedProcesses += finishBurst(processes, id, currentTime + 1, wheel);
+            }
+            else if (currentProcess->quantum == 0)
+            {
+                dequeueTask(array, level);
+                currentProcess->quantum = mainQ;
+                enqueueTask(array, processes, id);
+            }
+        }
+        else
+        {
+            currentTime = skipIdle(wheel, processes, currentTime);
+            continue;
+        }
+
+        currentTime++;
+    }
+
+    report(processes, mode, "PRI-" + std::to_string(mainQ), simulationTime);
+}
+
+void EDF(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes)
+{
+    realTimeSchedule(processes, mode, simulationTime, no_of_processes, laterDeadline, "EDF");
+}
+
+void RM(std::vector<Process> &processes, std::string mode, int simulationTime, int no_of_processes)
+{
+    realTimeSchedule(processes, mode, simulationTime, no_of_processes, longerPeriod, "RM");
+}
+
+//--------------------------------------------------------------------------
+// Query mode: after each policy run the run, wait and I/O segments go into an
+// interval index, and the query lines that follow the workload are answered
+// from it:
+//   at <t>                 who was running, waiting and blocked at tick t
+//   window <t1> <t2>       utilization, mean queue length and per-process
+//                          run/wait/blocked ticks over [t1, t2)
+
+struct Interval
+{
+    int start;
+    int end; // exclusive
+    int process;
+    char kind; // '*' running, '.' waiting, '~' blocked
+};
+
+// Node of a centered interval tree: it holds the intervals that contain its
+// center, sorted both ways so a stabbing query stops at the first miss.
+struct IntervalNode
+{
+    int center;
+    int left;
+    int right;
+    std::vector<int> byStart; // ascending start
+    std::vector<int> byEnd;   // descending end
+};
+
+struct ScheduleIndex
+{
+    std::vector<Interval> intervals;
+    std::vector<int> byStart; // every interval, ascending start
+    std::vector<IntervalNode> nodes;
+    int root;
+};
+
+int buildNode(ScheduleIndex &index, std::vector<int> &members)
+{
+    if (members.empty())
+    {
+        return -1;
+    }
+
+    // the median endpoint leaves at most half of the intervals on either side
+    std::vector<int> points;
+    for (int k : members)
+    {
+        points.push_back(index.intervals[k].start);
+        points.push_back(index.intervals[k].end - 1);
+    }
+    std::nth_element(points.begin(), points.begin() + points.size() / 2, points.end());
+    int center = points[points.size() / 2];
+
+    std::vector<int> left;
+    std::vector<int> right;
+    IntervalNode node;
+    node.center = center;
+    for (int k : members)
+    {
+        if (index.intervals[k].end <= center)
+            left.push_back(k);
+        else if (index.intervals[k].start > center)
+            right.push_back(k);
+        else
+            node.byStart.push_back(k);
+    }
+    node.byEnd = node.byStart;
+    std::sort(node.byStart.begin(), node.byStart.end(), [&index](int a, int b)
+              { return index.intervals[a].start < index.intervals[b].start; });
+    std::sort(node.byEnd.begin(), node.byEnd.end(), [&index](int a, int b)
+              { return index.intervals[a].end > index.intervals[b].end; });
+
+    int id = index.nodes.size();
+    index.nodes.push_back(node);
+    int leftChild = buildNode(index, left);
+    int rightChild = buildNode(index, right);
+    index.nodes[id].left = leftChild;
+    index.nodes[id].right = rightChild;
+    return id;
+}
+
+void buildIndex(std::vector<Process> &processes, ScheduleIndex &index)
+{
+    index.intervals.clear();
+    index.nodes.clear();
+
+    for (int k = 0; k < processes.size(); k++)
+    {
+        const Process &p = processes[k];
+        int t = p.arrivalTime;
+        int ri = 0;
+        int bi = 0;
+        // runs and blocks are disjoint and sorted; the gaps in between are waiting
+        while (ri < p.runs.size() || bi < p.blocks.size())
+        {
+            bool run = ri < p.runs.size() && (bi >= p.blocks.size() || p.runs[ri].start < p.blocks[bi].start);
+            const Segment &next = run ? p.runs[ri++] : p.blocks[bi++];
+            if (next.start > t)
+            {
+                index.intervals.push_back({t, next.start, k, '.'});
+            }
+            index.intervals.push_back({next.start, next.end, k, run ? '*' : '~'});
+            t = next.end;
+        }
+        if (p.finishTime > t)
+        {
+            index.intervals.push_back({t, p.finishTime, k, '.'});
+        }
+    }
+
+    std::vector<int> all(index.intervals.size());
+    for (int k = 0; k < all.size(); k++)
+    {
+        all[k] = k;
+    }
+    index.root = buildNode(index, all);
+    index.byStart = all;
+    std::sort(index.byStart.begin(), index.byStart.end(), [&index](int a, int b)
+              { return index.intervals[a].start < index.intervals[b].start; });
+}
+
+// Appends every interval containing tick t.
+void stabbingQuery(ScheduleIndex &index, int t, std::vector<int> &found)
+{
+    for (int id = index.root; id != -1;)
+    {
+        const IntervalNode &node = index.nodes[id];
+        if (t < node.center)
+        {
+            for (int k : node.byStart)
+            {
+                if (index.intervals[k].start > t)
+                    break;
+                found.push_back(k);
+            }
+            id = node.left;
+        }
+        else
+        {
+            for (int k : node.byEnd)
+            {
+                if (index.intervals[k].end <= t)
+                    break;
+                found.push_back(k);
+            }
+            id = node.right;
+        }
+    }
+}
+
+// Appends every interval overlapping [from, to): those containing from, plus
+// those starting strictly inside the window.
+void rangeQuery(ScheduleIndex &index, int from, int to, std::vector<int> &found)
+{
+    stabbingQuery(index, from, found);
+    auto first = std::upper_bound(index.byStart.begin(), index.byStart.end(), from, [&index](int t, int k)
+                                  { return t < index.intervals[k].start; });
+    for (auto it = first; it != index.byStart.end() && index.intervals[*it].start < to; ++it)
+    {
+        found.push_back(*it);
+    }
+}
+
+void pointPrint(std::vector<Process> &processes, ScheduleIndex &index, int t)
+{
+    std::vector<int> found;
+    stabbingQuery(index, t, found);
+
+    std::string running = "idle";
+    std::string waiting;
+    std::string blocked;
+    // report names in input order, whatever order the tree hands them back in
+    std::sort(found.begin(), found.end(), [&index](int a, int b)
+              { return index.intervals[a].process < index.intervals[b].process; });
+    for (int k : found)
+    {
+        char name = processes[index.intervals[k].process].name;
+        if (index.intervals[k].kind == '*')
+            running = std::string(1, name);
+        else if (index.intervals[k].kind == '.')
+            waiting += std::string(" ") + name;
+        else
+            blocked += std::string(" ") + name;
+    }
+    std::cout << "at " << t << ": running " << running
+              << " | waiting" << (waiting.empty() ? " -" : waiting)
+              << " | blocked" << (blocked.empty() ? " -" : blocked) << "\n";
+}
+
+void windowStatPrint(std::vector<Process> &processes, ScheduleIndex &index, int from, int to)
+{
+    std::vector<int> found;
+    rangeQuery(index, from, to, found);
+
+    // per process ticks by kind, only for processes seen in the window
+    std::map<int, std::map<char, int>> ticks;
+    int busy = 0;
+    int queued = 0;
+    for (int k : found)
+    {
+        const Interval &interval = index.intervals[k];
+        int length = std::min(interval.end, to) - std::max(interval.start, from);
+        ticks[interval.process][interval.kind] += length;
+        busy += interval.kind == '*' ? length : 0;
+        queued += interval.kind == '.' ? length : 0;
+    }
+
+    int span = std::max(to - from, 1);
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2) << 100.0 * busy / span << "% | mean queue "
+        << double(queued) / span;
+    std::cout << "window [" << from << "," << to << "): utilization " << oss.str() << "\n";
+    if (ticks.empty())
+    {
+        return;
+    }
+
+    std::cout << "Process" << "    ";
+    for (auto &entry : ticks)
+    {
+        std::cout << "|" << "  " << processes[entry.first].name << "  ";
+    }
+    const char *labels[] = {"Running", "Waiting", "Blocked"};
+    const char kinds[] = {'*', '.', '~'};
+    for (int row = 0; row < 3; row++)
+    {
+        std::cout << "|" << "\n"
+                  << labels[row] << "    ";
+        for (auto &entry : ticks)
+        {
+            printCenteredInt(entry.second[kinds[row]], 5);
+        }
+    }
+    std::cout << "|" << "\n";
+}
+
+// Answers the "at" and "window" query lines against one policy run.
+void queryPrint(std::vector<Process> &processes, std::string name, std::vector<std::string> &queries)
+{
+    ScheduleIndex index;
+    buildIndex(processes, index);
+
+    std::cout << name << "\n";
+    for (const std::string &query : queries)
+    {
+        std::istringstream in(query);
+        std::string kind;
+        int from = 0;
+        int to = 0;
+        in >> kind >> from;
+        if (kind == "at")
+        {
+            pointPrint(processes, index, from);
+        }
+        else if (kind == "window" && in >> to)
+        {
+            windowStatPrint(processes, index, from, to);
+        }
+    }
+    std::cout << "\n";
+}
+
+// Splits the policy line, e.g. "1,2-4,3", into policy numbers and quanta (-1 when absent).
+void parsePolicies(std::string line, std::vector<std::string> &policies, std::vector<int> &quantum)
+{
+    std::stringstream ss(line);
+    std::string policy;
+
+    while (std::getline(ss, policy, ','))
+    {
+        if (policy.find('-') != std::string::npos)
+        {
+            std::stringstream ss_policy(policy);
+            std::string policy_number;
+            std::string quantum_value;
+            std::getline(ss_policy, policy_number, '-');
+            std::getline(ss_policy, quantum_value);
+            policies.push_back(policy_number);
+            quantum.push_back(std::stoi(quantum_value));
+        }
+        else
+        {
+            policies.push_back(policy);
+            quantum.push_back(-1);
+        }
+    }
+}
+
+// Next comma-separated field of line starting at pos; pos moves past the comma.
+bool nextField(const std::string &line, size_t &pos, std::string &field)
+{
+    if (pos > line.size())
+    {
+        return false;
+    }
+    size_t end = std::min(line.find(',', pos), line.size());
+    field.assign(line, pos, end - pos);
+    pos = end + 1;
+    return true;
+}
+
+// One process line: name,arrival,service[,deadline[,period[,priority]]]. p
+// may be a process left over from an earlier workload; its vectors are reused.
+void parseProcess(const std::string &line, Process &p)
+{
+    std::string field;
+    size_t pos = 0;
+    nextField(line, pos, field);
+    p.name = field[0];
+    nextField(line, pos, field);
+    p.arrivalTime = std::stoi(field);
+    if (p.arrivalTime < 0)
+    {
+        throw std::invalid_argument("arrival time must not be negative: " + line);
+    }
+    if (!nextField(line, pos, field))
+    {
+        throw std::invalid_argument("missing service time: " + line);
+    }
+    // Either a single cpu burst or alternating cpu:io:cpu:... bursts; every
+    // burst is at least one tick, or it would never start or never block
+    p.serviceTime = 0;
+    p.bursts.clear();
+    for (size_t start = 0; start < field.size();)
+    {
+        size_t end = std::min(field.find(':', start), field.size());
+        int length = std::stoi(field.substr(start, end - start));
+        if (length < 1)
+        {
+            throw std::invalid_argument("bursts must be at least 1 tick: " + line);
+        }
+        if (p.bursts.size() % 2 == 0)
+        {
+            p.serviceTime += length;
+        }
+        p.bursts.push_back(length);
+        start = end + 1;
+    }
+    if (p.bursts.empty())
+    {
+        throw std::invalid_argument("missing service time: " + line);
+    }
+    // Optional real-time columns: relative deadline, then period
+    p.deadline = -1;
+    p.period = -1;
+    if (nextField(line, pos, field) && field.find_first_not_of(" \r") != std::string::npos)
+    {
+        p.deadline = std::stoi(field);
+    }
+    if (nextField(line, pos, field) && field.find_first_not_of(" \r") != std::string::npos)
+    {
+        p.period = std::stoi(field);
+    }
+    p.priority = DEFAULT_PRIORITY;
+    if (nextField(line, pos, field) && field.find_first_not_of(" \r") != std::string::npos)
+    {
+        p.priority = std::min(std::max(std::stoi(field), 0), PRIORITY_LEVELS - 1);
+    }
+    p.startTime = -1;
+    p.finishTime = -1;
+}
+
+// What every policy assumes of a process: an arrival it can hash into the
+// timer wheel and a non-empty burst list whose bursts all take time.
+bool validProcess(const Process &p)
+{
+    if (p.arrivalTime < 0 || p.bursts.empty())
+    {
+        return false;
+    }
+    for (int length : p.bursts)
+    {
+        if (length < 1)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reads simulation time, process count and process lines. Blank lines before
+// a workload are skipped so batches can separate workloads with them.
+bool readWorkload(std::istream &in, int &simulationTime, std::vector<Process> &processes)
+{
+    std::string line;
+    do
+    {
+        if (!std::getline(in, line))
+        {
+            return false;
+        }
+    } while (line.find_first_not_of(" \r") == std::string::npos);
+    simulationTime = std::stoi(line);
+
+    std::getline(in, line);
+    int no_of_processes = std::stoi(line);
+
+    int count = 0;
+    for (; count < no_of_processes && std::getline(in, line); ++count)
+    {
+        if (count == processes.size())
+        {
+            processes.emplace_back();
+        }
+        parseProcess(line, processes[count]);
+    }
+    processes.resize(count);
+    return count == no_of_processes;
+}
+
+void runPolicy(std::string policy, int quantum, std::vector<Process> &processes, std::string mode, int simulationTime)
+{
+    int no_of_processes = processes.size();
+
+    if (policy == "1")
+    {
+        FCFS(processes, mode, simulationTime, no_of_processes);
+    }
+    else if (policy == "2")
+    {
+        RoundRobin(processes, mode, simulationTime, no_of_processes, quantum);
+    }
+    else if (policy == "3")
+    {
+        SPN(processes, mode, simulationTime, no_of_processes);
+    }
+    else if (policy == "4")
+    {
+        SRT(processes, mode, simulationTime, no_of_processes);
+    }
+    else if (policy == "5")
+    {
+        HRRN(processes, mode, simulationTime, no_of_processes);
+    }
+    else if (policy == "6")
+    {
+        FB1(processes, mode, simulationTime, no_of_processes);
+    }
+    else if (policy == "7")
+    {
+        FB2i(processes, mode, simulationTime, no_of_processes);
+    }
+    else if (policy == "8")
+    {
+        EDF(processes, mode, simulationTime, no_of_processes);
+    }
+    else if (policy == "9")
+    {
+        RM(processes, mode, simulationTime, no_of_processes);
+    }
+    else if (policy == "10")
+    {
+        Priority(processes, mode, simulationTime, no_of_processes, quantum);
+    }
+}
+
+// 1-based policy number as written on the policy line, or 0 if runPolicy does not know it.
+int policyNumber(const std::string &policy)
+{
+    const char *numbers[] = {"1", "2", "3", "4", "5", "6", "7", "8", "9", "10"};
+    for (int k = 0; k < 10; k++)
+    {
+        if (policy == numbers[k])
+        {
+            return k + 1;
+        }
+    }
+    return 0;
+}
+
+// A policy runPolicy can run to completion: RR would spin forever on a quantum below 1.
+bool validPolicy(const std::string &policy, int quantum)
+{
+    int k = policyNumber(policy);
+    return k != 0 && (k != 2 || quantum >= 1);
+}
+
+// Checks a whole policy line up front, naming the first bad policy on stderr.
+bool checkPolicies(std::vector<std::string> &policies, std::vector<int> &quantum)
+{
+    for (int i = 0; i < policies.size(); ++i)
+    {
+        if (!validPolicy(policies[i], quantum[i]))
+        {
+            std::cerr << "lab6: unknown policy or missing RR quantum: " << policies[i] << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string policyName(std::string policy, int quantum)
+{
+    const char *names[] = {"FCFS", "RR-", "SPN", "SRT", "HRRN", "FB-1", "FB-2i", "EDF", "RM", "PRI-"};
+    int k = policyNumber(policy);
+    if (k == 0)
+    {
+        return policy;
+    }
+    if (k == 2)
+    {
+        return names[1] + std::to_string(quantum);
+    }
+    return k == 10 ? names[9] + std::to_string(std::max(quantum, 1)) : names[k - 1];
+}
+
+struct Stats
+{
+    float meanTurnaround;
+    float meanNormTurn;
+    int makespan;
+};
+
+Stats computeStats(std::vector<Process> &processes)
+{
+    Stats stats = {0, 0, 0};
+    for (const auto &process : processes)
+    {
+        stats.meanTurnaround += process.finishTime - process.arrivalTime;
+        stats.meanNormTurn += float(process.finishTime - process.arrivalTime) / float(process.serviceTime);
+        stats.makespan = std::max(stats.makespan, process.finishTime);
+    }
+    stats.meanTurnaround /= processes.size();
+    stats.meanNormTurn /= processes.size();
+    return stats;
+}
+
+//--------------------------------------------------------------------------
+// Batch mode: many small workloads from one stream, LANES of them simulated
+// in lock-step with one vector lane per workload. FCFS and SPN on single
+// burst workloads have lane kernels; RR (whose queue order differs from lane
+// to lane) and everything else runs the scalar policy per workload.
+
+const int LANES = 4; // one SSE register of ints at the default -march
+typedef int laneInt __attribute__((vector_size(LANES * sizeof(int))));
+
+// Structure-of-arrays view of a group: column j holds the j-th process (in
+// arrival order) of every lane. Missing processes have valid == 0.
+struct LaneBatch
+{
+    std::vector<laneInt> arrival;
+    std::vector<laneInt> service;
+    std::vector<laneInt> valid;
+};
+
+// Both kernels fill finish[j] with the finish time of column j in every lane.
+void laneFCFS(const LaneBatch &batch, std::vector<laneInt> &finish)
+{
+    laneInt now = {};
+    finish.resize(batch.arrival.size());
+
+    for (int j = 0; j < batch.arrival.size(); j++)
+    {
+        finish[j] = (now > batch.arrival[j] ? now : batch.arrival[j]) + batch.service[j];
+        now = batch.valid[j] ? finish[j] : now;
+    }
+}
+
+// Non-preemptive shortest-next: each step every lane picks its shortest
+// arrived job (earliest arrival on ties), jumping ahead when it is idle.
+void laneSPN(const LaneBatch &batch, std::vector<laneInt> &finish)
+{
+    const laneInt none = laneInt{} + INT_MAX;
+    int n = batch.arrival.size();
+    std::vector<laneInt> done(n);
+    for (int j = 0; j < n; j++)
+    {
+        done[j] = ~batch.valid[j];
+    }
+    finish.assign(n, laneInt{});
+
+    laneInt now = {};
+    for (int step = 0; step < n; step++)
+    {
+        laneInt next = none;
+        for (int j = 0; j < n; j++)
+        {
+            next = (~done[j] & (batch.arrival[j] < next)) ? batch.arrival[j] : next;
+        }
+        laneInt active = next != none;
+        now = (active & (now < next)) ? next : now;
+
+        laneInt best = none;
+        laneInt bestIndex = laneInt{} - 1;
+        for (int j = 0; j < n; j++)
+        {
+            laneInt pick = ~done[j] & (batch.arrival[j] <= now) & (batch.service[j] < best);
+            best = pick ? batch.service[j] : best;
+            bestIndex = pick ? laneInt{} + j : bestIndex;
+        }
+
+        now = active ? now + best : now;
+        for (int j = 0; j < n; j++)
+        {
+            laneInt picked = bestIndex == j;
+            finish[j] = picked ? now : finish[j];
+            done[j] |= picked;
+        }
+    }
+}
+
+void batchRow(int workload, std::string name, Stats stats)
+{
+    std::cout << workload << "," << name << ","
+              << std::fixed << std::setprecision(2) << stats.meanTurnaround << ","
+              << stats.meanNormTurn << "," << stats.makespan << "\n";
+}
+
+void batchGroup(std::vector<std::vector<Process>> &group, std::vector<int> &simulationTimes, int firstWorkload,
+                std::vector<std::string> &policies, std::vector<int> &quantum)
+{
+    // lanes whose workload is all single cpu bursts can take the vector kernels
+    LaneBatch batch;
+    std::vector<std::vector<Process *>> columns(group.size());
+    std::vector<bool> vectorLane(group.size());
+    int width = 0;
+    for (int lane = 0; lane < group.size(); lane++)
+    {
+        vectorLane[lane] = true;
+        for (const auto &process : group[lane])
+        {
+            vectorLane[lane] = vectorLane[lane] && process.bursts.size() == 1;
+        }
+        if (vectorLane[lane])
+        {
+            width = std::max(width, int(group[lane].size()));
+        }
+    }
+    batch.arrival.assign(width, laneInt{});
+    batch.service.assign(width, laneInt{});
+    batch.valid.assign(width, laneInt{});
+    for (int lane = 0; lane < group.size(); lane++)
+    {
+        if (!vectorLane[lane])
+        {
+            continue;
+        }
+        std::vector<Process *> &order = columns[lane];
+        for (auto &process : group[lane])
+        {
+            order.push_back(&process);
+        }
+        std::stable_sort(order.begin(), order.end(), [](Process *a, Process *b)
+                         { return a->arrivalTime < b->arrivalTime; });
+        for (int j = 0; j < order.size(); j++)
+        {
+            batch.arrival[j][lane] = order[j]->arrivalTime;
+            batch.service[j][lane] = order[j]->serviceTime;
+            batch.valid[j][lane] = -1;
+        }
+    }
+
+    std::vector<std::vector<Stats>> rows(group.size(), std::vector<Stats>(policies.size()));
+    for (int i = 0; i < policies.size(); ++i)
+    {
+        bool kernel = policies[i] == "1" || policies[i] == "3";
+        std::vector<laneInt> finish;
+        if (kernel && width > 0)
+        {
+            if (policies[i] == "1")
+                laneFCFS(batch, finish);
+            else
+                laneSPN(batch, finish);
+        }
+
+        for (int lane = 0; lane < group.size(); lane++)
+        {
+            if (kernel && vectorLane[lane])
+            {
+                for (int j = 0; j < columns[lane].size(); j++)
+                {
+                    columns[lane][j]->finishTime = finish[j][lane];
+                }
+                rows[lane][i] = computeStats(group[lane]);
+            }
+            else
+            {
+                runPolicy(policies[i], quantum[i], group[lane], "batch", simulationTimes[lane]);
+                rows[lane][i] = computeStats(group[lane]);
+            }
+        }
+    }
+
+    for (int lane = 0; lane < group.size(); lane++)
+    {
+        for (int i = 0; i < policies.size(); ++i)
+        {
+            batchRow(firstWorkload + lane, policyName(policies[i], quantum[i]), rows[lane][i]);
+        }
+    }
+}
+
+// Workloads follow the policy line back to back, each in the usual
+// simulation time / count / process lines format, until end of input.
+// Returns false without reading any of them if a policy is bad.
+bool batchRun(std::istream &in, std::vector<std::string> &policies, std::vector<int> &quantum)
+{
+    std::vector<std::vector<Process>> group(LANES);
+    std::vector<int> simulationTimes(LANES);
+    int workload = 0;
+    int lanes = 0;
+
+    if (!checkPolicies(policies, quantum))
+    {
+        return false;
+    }
+
+    std::cout << "workload,policy,turnaround,normturn,makespan\n";
+    while (readWorkload(in, simulationTimes[lanes], group[lanes]))
+    {
+        if (++lanes == LANES)
+        {
+            batchGroup(group, simulationTimes, workload, policies, quantum);
+            workload += lanes;
+            lanes = 0;
+        }
+    }
+    if (lanes > 0)
+    {
+        group.resize(lanes);
+        batchGroup(group, simulationTimes, workload, policies, quantum);
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------
+// Advise mode: runs every candidate policy on the workload and prints the
+// Pareto front over mean turnaround, p99 normalized turnaround and context
+// switches. The policy line picks the candidates; "all" (or nothing) means
+// every policy, RR with quanta 1 to 16, both feedback schemes, and PRI, EDF
+// and RM when the workload has priorities or deadlines for them to use.
+// Each run is handed the front found so far and gives up as soon as its
+// lower bounds are dominated, so hopeless candidates never run to the end.
+
+void adviseCandidates(std::vector<Process> &processes, std::vector<std::string> &policies, std::vector<int> &quantum)
+{
+    bool priorities = false;
+    bool deadlines = false;
+    for (const auto &process : processes)
+    {
+        priorities = priorities || process.priority != DEFAULT_PRIORITY;
+        deadlines = deadlines || process.deadline >= 0 || process.period >= 0;
+    }
+
+    // cheap, usually strong runs first so the front prunes the rest early:
+    // FCFS switches least and SRT/SPN keep turnaround low
+    const char *order[] = {"1", "4", "3", "5"};
+    for (const char *policy : order)
+    {
+        policies.push_back(policy);
+        quantum.push_back(-1);
+    }
+    for (int q = 1; q <= 16; q *= 2)
+    {
+        policies.push_back("2");
+        quantum.push_back(q);
+    }
+    policies.push_back("6");
+    quantum.push_back(-1);
+    policies.push_back("7");
+    quantum.push_back(-1);
+    if (priorities)
+    {
+        policies.push_back("10");
+        quantum.push_back(1);
+        policies.push_back("10");
+        quantum.push_back(4);
+    }
+    if (deadlines)
+    {
+        policies.push_back("8");
+        quantum.push_back(-1);
+        policies.push_back("9");
+        quantum.push_back(-1);
+    }
+}
+
+// Returns false without running anything if a candidate on the policy line is bad.
+bool advisePrint(std::vector<Process> &processes, std::vector<std::string> policies, std::vector<int> quantum,
+                 int simulationTime)
+{
+    if (policies.empty() || policies[0] == "all")
+    {
+        policies.clear();
+        quantum.clear();
+        adviseCandidates(processes, policies, quantum);
+    }
+    else if (!checkPolicies(policies, quantum))
+    {
+        return false;
+    }
+
+    std::vector<Objectives> front;
+    std::vector<std::string> names;
+    int cutShort = 0;
+    int dominated = 0;
+    Workspace &work = workspace();
+    for (int i = 0; i < policies.size(); ++i)
+    {
+        work.front = &front;
+        runPolicy(policies[i], quantum[i], processes, "advise", simulationTime);
+        work.front = nullptr;
+        if (work.pruned)
+        {
+            cutShort++;
+            continue;
+        }
+
+        Objectives result = runObjectives(processes, 0, work.switches);
+        bool kept = true;
+        for (const Objectives &best : front)
+        {
+            kept = kept && !dominates(best, result);
+        }
+        if (!kept)
+        {
+            dominated++;
+            continue;
+        }
+        // drop whatever the newcomer beats
+        for (int k = front.size() - 1; k >= 0; k--)
+        {
+            if (dominates(result, front[k]))
+            {
+                front.erase(front.begin() + k);
+                names.erase(names.begin() + k);
+                dominated++;
+            }
+        }
+        front.push_back(result);
+        names.push_back(policyName(policies[i], quantum[i]));
+    }
+
+    std::cout << "Pareto front of " << policies.size() << " candidates (" << cutShort
+              << " cut short, " << dominated << " dominated after a full run)\n";
+    std::cout << "Policy  | Turnaround | p99 NormTurn | Switches |\n";
+    for (int k = 0; k < front.size(); k++)
+    {
+        std::ostringstream row;
+        row << std::left << std::setw(8) << names[k] << "|" << std::right << std::fixed << std::setprecision(2)
+            << std::setw(11) << front[k].meanTurnaround << " |" << std::setw(13) << front[k].p99NormTurn << " |"
+            << std::setw(9) << front[k].switches << " |";
+        std::cout << row.str() << "\n";
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------
+// Server mode: a long running process answering many workloads. The mode
+// line "serve" reads requests from the rest of stdin; "serve <path>" listens
+// on a Unix domain socket at path instead. Every request and reply is framed
+// as a header line "<id> <length>" followed by length bytes of payload:
+//   request  the policy line, then a workload in the usual format
+//   reply    one "policy,turnaround,normturn,makespan" row per policy, or
+//            "error" if the request could not be parsed or simulated
+// Replies carry the id of their request and may come back out of order,
+// since requests are handled concurrently by a pool of worker threads. A
+// frame over MAX_FRAME_BYTES gets an "error" reply and ends its client.
+
+const long MAX_FRAME_BYTES = 16 << 20;
+
+// Reading side of a socket, so frames are parsed the same way as from stdin.
+class FdBuffer : public std::streambuf
+{
+public:
+    explicit FdBuffer(int fd) : fd(fd) {}
+
+protected:
+    int_type underflow() override
+    {
+        ssize_t got = read(fd, buffer, sizeof(buffer));
+        if (got <= 0)
+        {
+            return traits_type::eof();
+        }
+        setg(buffer, buffer, buffer + got);
+        return traits_type::to_int_type(buffer[0]);
+    }
+
+private:
+    int fd;
+    char buffer[4096];
+};
+
+// A client to reply to. Replies from different workers are written whole
+// under the lock; a socket is closed once its reader and all its jobs are done.
+struct Connection
+{
+    int fd;
+    bool owned; // false for stdout, which is not ours to close
+    std::mutex lock;
+
+    Connection(int fd, bool owned) : fd(fd), owned(owned) {}
+
+    ~Connection()
+    {
+        if (owned)
+        {
+            close(fd);
+        }
+    }
+};
+
+struct Job
+{
+    long id;
+    std::string payload;
+    std::shared_ptr<Connection> client;
+};
+
+struct WorkQueue
+{
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<Job> jobs;
+    bool closed = false;
+};
+
+enum FrameStatus
+{
+    FRAME_OK,
+    FRAME_END,      // end of input or a garbled header
+    FRAME_TOO_LARGE // id is valid, the payload was not read
+};
+
+FrameStatus readFrame(std::istream &in, long &id, std::string &payload)
+{
+    long length;
+    if (!(in >> id >> length) || length < 0)
+    {
+        return FRAME_END;
+    }
+    if (length > MAX_FRAME_BYTES)
+    {
+        return FRAME_TOO_LARGE;
+    }
+    in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    payload.resize(length);
+    return in.read(&payload[0], length) ? FRAME_OK : FRAME_END;
+}
+
+void writeFrame(Connection &client, long id, const std::string &payload)
+{
+    std::string frame = std::to_string(id) + " " + std::to_string(payload.size()) + "\n" + payload;
+    std::lock_guard<std::mutex> guard(client.lock);
+    for (size_t sent = 0; sent < frame.size();)
+    {
+        ssize_t put = write(client.fd, frame.data() + sent, frame.size() - sent);
+        if (put <= 0)
+        {
+            return; // the client went away; nothing left to tell it
+        }
+        sent += put;
+    }
+}
+
+// Runs every policy of one request silently and formats the stats rows. The
+// processes, policy lists and parse stream belong to the calling thread and
+// keep their capacity from one request to the next.
+void answer(const std::string &payload, std::string &reply)
+{
+    static thread_local std::istringstream in;
+    static thread_local std::vector<Process> processes;
+    static thread_local std::vector<std::string> policies;
+    static thread_local std::vector<int> quantum;
+    std::string line;
+    int simulationTime;
+
+    reply.clear();
+    in.clear();
+    in.str(payload);
+    policies.clear();
+    quantum.clear();
+    try
+    {
+        std::getline(in, line);
+        parsePolicies(line, policies, quantum);
+        if (!readWorkload(in, simulationTime, processes) || processes.empty())
+        {
+            reply = "error\n";
+            return;
+        }
+        // one bad request must not crash or hang the server for every client:
+        // a stuck worker is lost to the pool, a bad process is undefined
+        // behaviour in the engines, and an unknown policy would report the
+        // previous policy's finish times
+        for (const auto &process : processes)
+        {
+            if (!validProcess(process))
+            {
+                reply = "error\n";
+                return;
+            }
+        }
+        for (int i = 0; i < policies.size(); ++i)
+        {
+            if (!validPolicy(policies[i], quantum[i]))
+            {
+                reply = "error\n";
+                return;
+            }
+        }
+        for (int i = 0; i < policies.size(); ++i)
+        {
+            runPolicy(policies[i], quantum[i], processes, "serve", simulationTime);
+            Stats stats = computeStats(processes);
+            char row[64];
+            snprintf(row, sizeof(row), ",%.2f,%.2f,%d\n", stats.meanTurnaround, stats.meanNormTurn, stats.makespan);
+            reply += policyName(policies[i], quantum[i]) + row;
+        }
+    }
+    catch (const std::exception &)
+    {
+        reply = "error\n"; // a malformed number somewhere in the request
+    }
+}
+
+void serveWorker(WorkQueue &queue)
+{
+    std::string reply;
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> guard(queue.lock);
+            queue.ready.wait(guard, [&queue]
+                             { return queue.closed || !queue.jobs.empty(); });
+            if (queue.jobs.empty())
+            {
+                return;
+            }
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        answer(job.payload, reply);
+        writeFrame(*job.client, job.id, reply);
+    }
+}
+
+// Queues every frame of one client until it closes its end.
+void serveClient(std::istream &in, std::shared_ptr<Connection> client, WorkQueue &queue)
+{
+    Job job;
+    FrameStatus status;
+    while ((status = readFrame(in, job.id, job.payload)) == FRAME_OK)
+    {
+        job.client = client;
+        {
+            std::lock_guard<std::mutex> guard(queue.lock);
+            queue.jobs.push_back(std::move(job));
+        }
+        queue.ready.notify_one();
+    }
+    if (status == FRAME_TOO_LARGE)
+    {
+        writeFrame(*client, job.id, "error\n");
+    }
+}
+
+void serveSocket(std::shared_ptr<Connection> client, WorkQueue &queue)
+{
+    FdBuffer buffer(client->fd);
+    std::istream in(&buffer);
+    serveClient(in, client, queue);
+}
+
+int serve(std::string mode)
+{
+    std::istringstream args(mode);
+    std::string kind;
+    std::string path;
+    args >> kind >> path;
+
+    WorkQueue queue;
+    std::vector<std::thread> workers(std::max(std::thread::hardware_concurrency(), 1u));
+    for (auto &worker : workers)
+    {
+        worker = std::thread(serveWorker, std::ref(queue));
+    }
+
+    if (path.empty())
+    {
+        serveClient(std::cin, std::make_shared<Connection>(STDOUT_FILENO, false), queue);
+    }
+    else
+    {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0 || path.size() >= sizeof(address.sun_path))
         {
-            SPN(processes, mode, simulationTime, no_of_processes);
+            std::cerr << "serve: cannot use socket " << path << "\n";
+            return 1;
         }
-        else if (policy == "4")
+        path.copy(address.sun_path, path.size());
+        unlink(path.c_str());
+        if (bind(listener, (sockaddr *)&address, sizeof(address)) < 0 || listen(listener, 64) < 0)
         {
-            SRT(processes, mode, simulationTime, no_of_processes);
+            std::cerr << "serve: cannot listen on " << path << "\n";
+            return 1;
         }
-        else if (policy == "5")
+        signal(SIGPIPE, SIG_IGN); // a client hanging up must not take the server down
+
+        int fd;
+        while ((fd = accept(listener, nullptr, nullptr)) >= 0)
         {
-            HRRN(processes, mode, simulationTime, no_of_processes);
+            std::thread(serveSocket, std::make_shared<Connection>(fd, true), std::ref(queue)).detach();
         }
-        else if (policy == "6")
+        close(listener);
+    }
+
+    // out of input (or accept failed): finish what is queued, then stop
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.closed = true;
+    }
+    queue.ready.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    return 0;
+}
+
+int main()
+{
+    std::string mode;
+    std::vector<std::string> policies;
+    int simulationTime;
+    std::vector<Process> processes;
+    std::vector<int> quantum;
+
+    std::string line;
+
+    std::ios::sync_with_stdio(false);
+
+    //Mode
+    std::getline(std::cin, mode);
+
+    if (mode.compare(0, 5, "serve") == 0)
+    {
+        return serve(mode);
+    }
+
+    //Policy, simulation time, number of processes and process details
+    try
+    {
+        std::getline(std::cin, line);
+        parsePolicies(line, policies, quantum);
+
+        if (mode.compare(0, 5, "batch") == 0)
         {
-            FB1(processes, mode, simulationTime, no_of_processes);
+            return batchRun(std::cin, policies, quantum) ? 0 : 1;
         }
-        else if (policy == "7")
+        readWorkload(std::cin, simulationTime, processes);
+    }
+    catch (const std::logic_error &e) // invalid_argument, or out_of_range from stoi
+    {
+        std::cerr << "lab6: bad input: " << e.what() << "\n";
+        return 1;
+    }
+
+    if (mode.compare(0, 6, "advise") == 0)
+    {
+        return advisePrint(processes, policies, quantum, simulationTime) ? 0 : 1;
+    }
+
+    //Query lines, in query mode
+    bool query = mode.compare(0, 5, "query") == 0;
+    std::vector<std::string> queries;
+    while (query && std::getline(std::cin, line))
+    {
+        queries.push_back(line);
+    }
+
+    // back to back <svg> roots would not be one document; html holds any number
+    if (mode.compare(0, 3, "svg") == 0 && policies.size() > 1)
+    {
+        std::cerr << "lab6: svg mode draws a single policy; use html for several\n";
+        return 1;
+    }
+
+    bool html = mode.compare(0, 4, "html") == 0;
+    if (html)
+    {
+        std::cout << "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>Schedule</title></head><body>\n";
+    }
+
+    for (int i = 0; i < policies.size(); ++i)
+    {
+        runPolicy(policies[i], quantum[i], processes, mode, simulationTime);
+        if (query)
         {
-            FB2i(processes, mode, simulationTime, no_of_processes);
+            queryPrint(processes, policyName(policies[i], quantum[i]), queries);
         }
     }
 
+    if (html)
+    {
+        std::cout << "</body></html>\n";
+    }
+
     return 0;
 }